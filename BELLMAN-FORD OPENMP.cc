@@ -1,15 +1,19 @@
 #include <atomic>
 #include<vector>
 #include<algorithm>
-#include "../../atomicUtil.h"
-#include "../../graph.hpp"
+#include<cstdlib>
+#include "atomicUtil.h"
+#include "dist_types.h"
+#include "bench.h"
+#include "graph.hpp"
+#include "instrument.h"
 
 void Compute_SSSP(graph& g,int* weight,int* dist,int src)
 {
 
    bool* modified=new bool[g.num_nodes()];
    bool* modified_nxt=new bool[g.num_nodes()];
-   #pragma omp parallelfor
+   #pragma omp parallel for
    for (int t = 0; t<g.num_nodes(); t ++) 
     {
     dist[t] = INT_MAX;
@@ -28,12 +32,14 @@ void Compute_SSSP(graph& g,int* weight,int* dist,int src)
     finished=true;
     #pragma omp parallel
    {
-    #pragma omp for
+    INSTR_BEGIN(PHASE_RELAX);
+    #pragma omp for nowait
     for (int v = 0; v < g.num_nodes(); v ++) 
     { 
 
       if (modified[v] == true )
         {
+        INSTR_COUNT(COUNT_RELAXATIONS, g.indexofNodes[v+1] - g.indexofNodes[v]);
         for (int edge = g.indexofNodes[v]; edge < g.indexofNodes[v+1]; edge ++) 
         {  
            int nbr = g.edgeList[edge] ;
@@ -41,50 +47,449 @@ void Compute_SSSP(graph& g,int* weight,int* dist,int src)
            int dist_new = dist[v] + weight[e];
         
             bool modified_new = true;
-            if(dist[nbr]>dist_new)
+            if(dist[nbr]>dist_new && atomicMin(&dist[nbr],dist_new))
                {
-                 int oldValue = dist[nbr];
-                 atomicMin(&dist[nbr],dist_new);
                  finished=false;  
                  modified_nxt[nbr]=modified_new;
+                 INSTR_COUNT(COUNT_UPDATES, 1);
               }
 
           }
       }
      
     }
+    INSTR_END(PHASE_RELAX);
+    INSTR_BEGIN(PHASE_BARRIER);
+    #pragma omp barrier
+    INSTR_END(PHASE_BARRIER);
 
+    INSTR_BEGIN(PHASE_FRONTIER);
     #pragma omp for
     for (int v = 0; v <g.num_nodes(); v ++) 
       {
          modified[v]=modified_nxt[v];
          modified_nxt[v]=false;
       }  
+    INSTR_END(PHASE_FRONTIER);
    }
   
   }  
 }
 
-int main()
+// Per-iteration record of the worklist variant.
+struct IterationStats {
+   long frontier;
+   long relaxations;
+   bool pull;
+   double time;
+};
+
+// Worklist Bellman-Ford. The active vertices are kept as a compact frontier
+// array, so an iteration costs O(frontier edges) instead of O(V). Each
+// thread appends the vertices it improves to its own queue; an atomic
+// test-and-set on inNext keeps a vertex from being queued twice, and the queues
+// are concatenated into the next frontier at prefix-sum offsets before the
+// two frontier buffers are swapped.
+// Once the frontier holds more than n / denseDivisor vertices the iteration
+// switches to a dense pull sweep over the reverse graph: every vertex scans
+// its in-edges from active vertices and only ever writes its own distance,
+// so no atomics are needed. weight must be g.getEdgeLen(), or a copy of it
+// in Dist; pull sweeps read the matching weights of the reverse graph.
+// Dist is any distance type of dist_types.h: adds saturate at its infinity.
+template <typename Dist>
+void Compute_SSSP_worklist(graph& g, const Dist* weight, Dist* dist, int src, int denseDivisor,
+                           std::vector<IterationStats>* stats)
+{
+  typedef DistTraits<Dist> T;
+  int n = g.num_nodes();
+  Graph* rev = g.reverse();
+  int maxThreads = omp_get_max_threads();
+
+  int* frontier = new int[n];
+  int* next = new int[n];
+  unsigned char* inNext = new unsigned char[n];
+  char* active = new char[n];
+  char* activeNext = new char[n];
+  std::vector<std::vector<int>> queue(maxThreads);
+  std::vector<long> offset(maxThreads + 1);
+
+  long frontierSize = 1;
+  bool dense = false;
+  long denseThreshold = n / denseDivisor;
+
+  #pragma omp parallel for
+  for (int v = 0; v < n; v++)
+  {
+    dist[v] = T::inf();
+    inNext[v] = 0;
+    active[v] = 0;
+    activeNext[v] = 0;
+  }
+  dist[src] = 0;
+  frontier[0] = src;
+
+  while (frontierSize > 0)
+  {
+    double startTime = omp_get_wtime();
+    long relaxations = 0;
+    bool pull = frontierSize > denseThreshold;
+
+    if (pull)
+    {
+      if (!dense)
+      {
+        #pragma omp parallel for
+        for (long i = 0; i < frontierSize; i++)
+          active[frontier[i]] = 1;
+      }
+      long count = 0;
+      #pragma omp parallel reduction(+:relaxations, count)
+      {
+      INSTR_BEGIN(PHASE_RELAX);
+      #pragma omp for schedule(dynamic, 256) nowait
+      for (int v = 0; v < n; v++)
+      {
+        Dist best = dist[v];
+        for (long e = rev->indexofNodes[v]; e < rev->indexofNodes[v + 1]; e++)
+        {
+          int u = rev->edgeList[e];
+          if (!active[u])
+            continue;
+          relaxations++;
+          Dist dist_new = T::add(dist[u], (Dist)rev->edgeLen[e]);
+          if (dist_new < best)
+            best = dist_new;
+        }
+        activeNext[v] = best < dist[v];
+        if (best < dist[v])
+        {
+          dist[v] = best;
+          count++;
+        }
+      }
+      INSTR_END(PHASE_RELAX);
+      }
+      INSTR_COUNT(COUNT_UPDATES, count);
+      std::swap(active, activeNext);
+      frontierSize = count;
+      dense = true;
+    }
+    else
+    {
+      if (dense)
+      {
+        // Back to sparse: rebuild the frontier list from the active flags.
+        // Every slot is cleared, not just those of the team below, since
+        // all maxThreads of them are concatenated afterwards.
+        INSTR_BEGIN(PHASE_FRONTIER);
+        for (int t = 0; t < maxThreads; t++)
+          queue[t].clear();
+        #pragma omp parallel
+        {
+          int tid = omp_get_thread_num();
+          #pragma omp for schedule(static)
+          for (int v = 0; v < n; v++)
+            if (active[v])
+            {
+              queue[tid].push_back(v);
+              active[v] = 0;
+            }
+        }
+        frontierSize = 0;
+        for (int t = 0; t < maxThreads; t++)
+        {
+          std::copy(queue[t].begin(), queue[t].end(), frontier + frontierSize);
+          frontierSize += queue[t].size();
+        }
+        INSTR_END(PHASE_FRONTIER);
+        dense = false;
+      }
+
+      #pragma omp parallel reduction(+:relaxations)
+      {
+        int tid = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        std::vector<int>& mine = queue[tid];
+        mine.clear();
+
+        INSTR_BEGIN(PHASE_RELAX);
+        #pragma omp for schedule(dynamic, 64) nowait
+        for (long i = 0; i < frontierSize; i++)
+        {
+          int v = frontier[i];
+          Dist d = dist[v];
+          for (long edge = g.indexofNodes[v]; edge < g.indexofNodes[v + 1]; edge++)
+          {
+            int nbr = g.edgeList[edge];
+            Dist dist_new = T::add(d, weight[edge]);
+            relaxations++;
+            if (dist_new < dist[nbr] && atomicMin(&dist[nbr], dist_new))
+            {
+              INSTR_COUNT(COUNT_UPDATES, 1);
+              if (testAndSetFlag(&inNext[nbr]))
+                mine.push_back(nbr);
+            }
+          }
+        }
+        INSTR_END(PHASE_RELAX);
+        INSTR_BEGIN(PHASE_BARRIER);
+        #pragma omp barrier
+        INSTR_END(PHASE_BARRIER);
+
+        INSTR_BEGIN(PHASE_FRONTIER);
+        #pragma omp single
+        {
+          offset[0] = 0;
+          for (int t = 0; t < nt; t++)
+            offset[t + 1] = offset[t] + queue[t].size();
+        }
+        for (size_t i = 0; i < mine.size(); i++)
+        {
+          next[offset[tid] + i] = mine[i];
+          inNext[mine[i]] = 0;
+        }
+        #pragma omp single
+        frontierSize = offset[nt];
+        INSTR_END(PHASE_FRONTIER);
+      }
+      std::swap(frontier, next);
+    }
+
+    INSTR_COUNT(COUNT_RELAXATIONS, relaxations);
+    if (stats)
+    {
+      IterationStats it = { frontierSize, relaxations, pull, omp_get_wtime() - startTime };
+      stats->push_back(it);
+    }
+  }
+
+  delete[] frontier;
+  delete[] next;
+  delete[] inNext;
+  delete[] active;
+  delete[] activeNext;
+}
+
+struct BellmanFordRun {
+  graph* g;
+  int* weight;
+  int* dist;
+  int src;
+  int denseDivisor;
+};
+
+static void runOriginal(void* arg)
+{
+  BellmanFordRun* r = (BellmanFordRun*)arg;
+  Compute_SSSP(*r->g, r->weight, r->dist, r->src);
+}
+
+static void runWorklist(void* arg)
+{
+  BellmanFordRun* r = (BellmanFordRun*)arg;
+  Compute_SSSP_worklist(*r->g, r->weight, r->dist, r->src, r->denseDivisor, NULL);
+}
+
+template <typename Dist>
+struct TypedRun {
+  graph* g;
+  std::vector<Dist> weight;
+  std::vector<Dist> dist;
+  int src;
+  int denseDivisor;
+};
+
+template <typename Dist>
+static void runWorklistTyped(void* arg)
+{
+  TypedRun<Dist>* r = (TypedRun<Dist>*)arg;
+  Compute_SSSP_worklist(*r->g, &r->weight[0], &r->dist[0], r->src, r->denseDivisor, NULL);
+}
+
+// The worklist kernel with weights and distances narrowed to Dist, checked
+// against the int distances in expected.
+template <typename Dist>
+static void benchWorklistTyped(BenchConfig* cfg, graph& g, int src, int denseDivisor, const char* input,
+                               const int* expected)
+{
+  TypedRun<Dist> run;
+  run.g = &g;
+  run.weight.resize(g.num_edges() + 1);
+  run.dist.resize(g.num_nodes() + 1);
+  run.src = src;
+  run.denseDivisor = denseDivisor;
+  distConvert(g.getEdgeLen(), &run.weight[0], g.num_edges());
+  char kernel[64];
+  snprintf(kernel, sizeof(kernel), "bellman-ford-worklist-%s", dist_type_name(DistTraits<Dist>::type));
+  bench_run(cfg, kernel, input, NULL, runWorklistTyped<Dist>, &run, 0, NULL);
+  long mismatches = distMismatches(&run.dist[0], expected, g.num_nodes());
+  if (mismatches)
+    printf("  %s DISTANCES DIFFER for %ld vertices\n", dist_type_name(DistTraits<Dist>::type), mismatches);
+}
+
+// The i32 kernel on a generated DAG with negative weights, against a
+// single relaxation pass in topological order. Vertex n is never reached
+// and only has negative out-edges, so an add to infinity must stay there.
+// Runs once with the given divisor and once with every frontier past one
+// vertex going through the pull sweep.
+static void checkNegativeWeights(int denseDivisor)
+{
+  const int n = 4096;
+  std::vector<int> src, dst, w;
+  for (int v = 0; v < n; v++)
+  {
+    if (v + 1 < n) { src.push_back(v); dst.push_back(v + 1); w.push_back(v % 3 == 0 ? -2 : 3); }
+    if (v + 7 < n) { src.push_back(v); dst.push_back(v + 7); w.push_back(v % 5 - 3); }
+    src.push_back(n); dst.push_back(v); w.push_back(-5);
+  }
+  Graph csr;
+  build_graph(&csr, n + 1, (long)src.size(), &src[0], &dst[0], &w[0], false);
+  graph g("negative-weight check");
+  g.adopt(&csr);
+
+  std::vector<int32_t> expected(n + 1, INT32_MAX);
+  expected[0] = 0;
+  for (int v = 0; v < n; v++)
+    if (expected[v] != INT32_MAX)
+      for (long e = g.indexofNodes[v]; e < g.indexofNodes[v + 1]; e++)
+        expected[g.edgeList[e]] = std::min(expected[g.edgeList[e]], expected[v] + g.getEdgeLen()[e]);
+
+  std::vector<int32_t> weight(g.num_edges()), dist(n + 1);
+  distConvert(g.getEdgeLen(), &weight[0], g.num_edges());
+  int divisors[2] = { denseDivisor, n };
+  for (int i = 0; i < 2; i++)
+  {
+    Compute_SSSP_worklist(g, &weight[0], &dist[0], 0, divisors[i], NULL);
+    long mismatches = distMismatches(&dist[0], &expected[0], n + 1);
+    if (mismatches)
+      printf("  NEGATIVE-WEIGHT DISTANCES DIFFER for %ld vertices (dense divisor %d)\n", mismatches, divisors[i]);
+  }
+}
+
+int main(int argc, char* argv[])
 { 
+   const char* path;
+   bool undirected;
+   BenchConfig cfg;
 
- 
-   graph G("../../dataRecords/Email-Enron.txt");
+   // e.g. ../../dataRecords/Email-Enron.txt [directed|undirected] [dense divisor] --threads 1-16 --csv results.csv --reorder rcm
+   bench_parse_args(&argc, argv, &cfg);
+   parse_graph_args(argc, argv, &path, &undirected, false);
+   graph G(path, undirected);
    G.parseGraph();
 
-  int* edgeLen=G.getEdgeLen();
   int* dist=new int[G.num_nodes()+1];
+  int* distWorklist=new int[G.num_nodes()+1];
+   int denseDivisor = argc > 3 ? atoi(argv[3]) : 20;
+   if (denseDivisor < 1)
+   {
+     fprintf(stderr, "Error: dense divisor must be a positive integer\n");
+     return 1;
+   }
 
-   int src=0;
+   // With --reorder everything below runs on the relabelled graph from the
+   // same source vertex; distances are printed by original id at the end.
+   int* perm = NULL;
+   char input[512];
+   snprintf(input, sizeof(input), "%s", path);
+   if (cfg.reorder != NULL)
+   {
+     int kind = parse_reorder(cfg.reorder);
+     // The second of two runs is timed, so neither side pays for page
+     // faults and cold caches.
+     double before=0, after=0;
+     G.reverse();
+     for (int rep = 0; rep < 2; rep++)
+     {
+       double startTime=omp_get_wtime();
+       Compute_SSSP_worklist(G,G.getEdgeLen(),dist,0,denseDivisor,NULL);
+       before=omp_get_wtime()-startTime;
+     }
+     ReorderStats reorderStats;
+     perm = G.reorder(kind, &reorderStats);
+     G.reverse();
+     for (int rep = 0; rep < 2; rep++)
+     {
+       double startTime=omp_get_wtime();
+       Compute_SSSP_worklist(G,G.getEdgeLen(),distWorklist,reorder_id(perm, 0),denseDivisor,NULL);
+       after=omp_get_wtime()-startTime;
+     }
+     int mismatches = 0;
+     for (int i = 0; i < G.num_nodes(); i++)
+       if (distWorklist[reorder_id(perm, i)] != dist[i])
+         mismatches++;
+     if (kind != REORDER_NONE)
+       reorder_report(&reorderStats, "bellman-ford-worklist", before, after);
+     if (mismatches)
+       printf("  REORDERED DISTANCES DIFFER for %d vertices\n", mismatches);
+     snprintf(input, sizeof(input), "%s, %s order", path, reorder_name(kind));
+   }
+
+  int* edgeLen=G.getEdgeLen();
+   int src=reorder_id(perm, 0);
    double startTime=omp_get_wtime();
    Compute_SSSP(G,edgeLen,dist,src);
    double endTime=omp_get_wtime();
    printf("RunTime : %f\n",endTime-startTime);
 
-   for (int i = 0; i <10; i++)
+   std::vector<IterationStats> stats;
+   G.reverse();
+   startTime=omp_get_wtime();
+   Compute_SSSP_worklist(G,edgeLen,distWorklist,src,denseDivisor,&stats);
+   endTime=omp_get_wtime();
+
+   long relaxations = 0;
+   for (size_t i = 0; i < stats.size(); i++)
+   {
+     relaxations += stats[i].relaxations;
+     printf("Iteration %zu : %s, frontier %ld -> %ld, relaxations %ld, %f s\n", i,
+            stats[i].pull ? "pull" : "push", i ? stats[i - 1].frontier : 1L,
+            stats[i].frontier, stats[i].relaxations, stats[i].time);
+   }
+   int mismatches = 0;
+   for (int i = 0; i < G.num_nodes(); i++)
+     if (dist[i] != distWorklist[i])
+       mismatches++;
+   printf("Worklist RunTime : %f, iterations %zu, %.1f M relaxations/s%s\n", endTime-startTime,
+          stats.size(), relaxations / (endTime-startTime) / 1e6, mismatches ? ", DISTANCES DIFFER" : "");
+
+   BellmanFordRun run = { &G, edgeLen, distWorklist, src, denseDivisor };
+   bench_run(&cfg, "bellman-ford", input, NULL, runOriginal, &run, 0, NULL);
+   bench_run(&cfg, "bellman-ford-worklist", input, NULL, runWorklist, &run, 0, NULL);
+
+   // Again on the narrowest distance type that holds every shortest path
+   int minWeight = 0, maxWeight = 0;
+   for (long e = 0; e < G.num_edges(); e++)
+   {
+     minWeight = std::min(minWeight, edgeLen[e]);
+     maxWeight = std::max(maxWeight, edgeLen[e]);
+   }
+   switch (dist_type_for(minWeight, maxWeight, G.num_nodes()))
+   {
+   case DIST_U8:  benchWorklistTyped<uint8_t>(&cfg, G, src, denseDivisor, input, dist); break;
+   case DIST_U16: benchWorklistTyped<uint16_t>(&cfg, G, src, denseDivisor, input, dist); break;
+   case DIST_I64: benchWorklistTyped<int64_t>(&cfg, G, src, denseDivisor, input, dist); break;
+   default:       benchWorklistTyped<int32_t>(&cfg, G, src, denseDivisor, input, dist);
+   }
+   checkNegativeWeights(denseDivisor);
+
+   if (INSTR_ENABLED)
+   {
+     instr_reset();
+     runOriginal(&run);
+     instr_report("bellman-ford");
+     instr_reset();
+     runWorklist(&run);
+     instr_report("bellman-ford-worklist");
+   }
+
+   for (int i = 0; i <10 && i < G.num_nodes(); i++)
   {
-    printf( "%d  %d\n", i, dist[i]);
+    printf( "%d  %d\n", i, dist[reorder_id(perm, i)]);
   }
 
+  free(perm);
+  delete[] distWorklist;
+  delete[] dist;
   return 0;
 }
@@ -1,118 +1,568 @@
 #include <iostream>
 #include <vector>
-#include <queue>
+#include <algorithm>
 #include <limits>
 #include <cmath>
+#include <cstring>
 #include <omp.h>
-#include "../../graph.hpp"
+#include "atomicUtil.h"
+#include "dist_types.h"
+#include "bench.h"
+#include "graph.hpp"
+#include "dynamic_graph.hpp"
+#include "instrument.h"
 
 const int INF = std::numeric_limits<int>::max();
 
-struct Edge {
-    int src, dst, weight;
-    Edge(int s, int d, int w) : src(s), dst(d), weight(w) {}
+// Upper bound on the bucket slots of Compute_SSSP, so a large maximum weight
+// over a small delta cannot blow up the per-thread slot arrays.
+const long MAX_BUCKET_SLOTS = 1024;
+
+// Timings for one non-empty bucket.
+struct BucketStats {
+    long index;
+    int lightPhases;
+    long settled;
+    double lightTime;
+    double heavyTime;
 };
 
-struct Bucket {
-    std::vector<std::vector<int>> buckets;
-    int delta;
+// Adjacency reordered so the light edges (weight <= delta) of every vertex
+// come first: the light phase walks [indexofNodes[v], lightEnd[v]) and the
+// heavy phase [lightEnd[v], indexofNodes[v+1]).
+template <typename Dist>
+struct SplitEdges {
+    std::vector<long> lightEnd;
+    std::vector<int> nbr;
+    std::vector<Dist> len;
 
-    Bucket(int num_nodes, int delta) : delta(delta) {
-        buckets.resize((num_nodes * delta) / delta + 1);
+    SplitEdges(graph& g, const Dist* weight, int delta)
+        : lightEnd(g.num_nodes()), nbr(g.num_edges()), len(g.num_edges()) {
+        #pragma omp parallel for schedule(dynamic, 1024)
+        for (int v = 0; v < g.num_nodes(); v++) {
+            long out = g.indexofNodes[v];
+            for (long e = g.indexofNodes[v]; e < g.indexofNodes[v + 1]; e++)
+                if (weight[e] <= delta) {
+                    nbr[out] = g.edgeList[e];
+                    len[out++] = weight[e];
+                }
+            lightEnd[v] = out;
+            for (long e = g.indexofNodes[v]; e < g.indexofNodes[v + 1]; e++)
+                if (weight[e] > delta) {
+                    nbr[out] = g.edgeList[e];
+                    len[out++] = weight[e];
+                }
+        }
     }
+};
 
-    void insert(int node, int dist) {
-        int index = dist / delta;
-        buckets[index].push_back(node);
-    }
+// Picks delta from the weights and the average degree, following Meyer and
+// Sanders: delta ~ max weight / degree keeps the light phases short without
+// letting buckets fill up with vertices that get re-relaxed. The 99th
+// percentile of a weight sample stands in for the maximum so that a few
+// outlier edges do not blow up the buckets.
+int chooseDelta(graph& g, int* weight) {
+    long m = g.num_edges();
+    if (m == 0)
+        return 1;
+    long step = m > 1000000 ? m / 1000000 : 1;
+    std::vector<int> sample;
+    for (long e = 0; e < m; e += step)
+        sample.push_back(weight[e]);
+    std::sort(sample.begin(), sample.end());
+    int high = sample[(long)(sample.size() - 1) * 99 / 100];
+    double avgDegree = (double)m / std::max(1, g.num_nodes());
+    int delta = (int)(high / std::max(1.0, avgDegree));
+    return std::max(std::max(delta, sample[0]), 1);
+}
 
-    std::vector<int> getMinBucket() {
-        for (auto& bucket : buckets) {
-            if (!bucket.empty()) {
-                return bucket;
-            }
+// Delta-stepping SSSP. Buckets live in a cyclic array of maxWeight/delta + 2
+// slots, so finding the next bucket never rescans from bucket 0. The array
+// is capped at MAX_BUCKET_SLOTS: the slots then cover a window of buckets
+// starting at windowStart, entries past it go to a per-thread overflow
+// list, and that list is only scanned when the window runs empty, to start
+// the next window at its lowest bucket. Every
+// thread inserts into its own copy of the bucket slots; at the start of a
+// phase the copies for the current slot are concatenated into the frontier
+// at precomputed offsets, without locks. Entries are never removed when a
+// vertex moves to a lower bucket: stale entries are dropped when their
+// bucket is processed (lazy deletion). Light phases repeat until the
+// current bucket stays empty; heavy edges are relaxed once per bucket from
+// the set of vertices it settled.
+// Dist is any distance type of dist_types.h; adds saturate at its infinity.
+template <typename Dist>
+void Compute_SSSP(graph& g, const Dist* weight, Dist* dist, int src, int delta,
+                  std::vector<BucketStats>* stats) {
+    typedef DistTraits<Dist> T;
+    int num_nodes = g.num_nodes();
+    Dist maxWeight = 0;
+    #pragma omp parallel for reduction(max:maxWeight)
+    for (long e = 0; e < g.num_edges(); e++)
+        maxWeight = std::max(maxWeight, weight[e]);
+
+    SplitEdges<Dist> edges(g, weight, delta);
+    int numSlots = (int)std::min((long)(maxWeight / delta) + 2, MAX_BUCKET_SLOTS);
+    int maxThreads = omp_get_max_threads();
+
+    std::vector<std::vector<std::vector<int>>> local(maxThreads, std::vector<std::vector<int>>(numSlots));
+    std::vector<std::vector<int>> settled(maxThreads);
+    std::vector<std::vector<int>> overflow(maxThreads);
+    std::vector<long> offset(maxThreads + 1);
+    std::vector<int> frontier;
+    std::vector<Dist> lastRelaxed(num_nodes);
+    std::vector<unsigned char> inSettled(num_nodes);
+
+    long current = -1;
+    long windowStart = 0;
+    long frontierSize = 0;
+    BucketStats bucket;
+    double phaseStart = 0;
+
+    #pragma omp parallel
+    {
+        int tid = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        std::vector<std::vector<int>>& mine = local[tid];
+
+        #pragma omp for
+        for (int v = 0; v < num_nodes; v++) {
+            dist[v] = T::inf();
+            lastRelaxed[v] = T::inf();
+            inSettled[v] = 0;
+        }
+        #pragma omp single
+        {
+            dist[src] = 0;
+            local[0][0].push_back(src);
         }
-        return std::vector<int>();
-    }
 
-    void clearMinBucket() {
-        for (auto& bucket : buckets) {
-            if (!bucket.empty()) {
-                bucket.clear();
+        for (;;) {
+            INSTR_BEGIN(PHASE_FRONTIER);
+            #pragma omp single
+            {
+                long next = -1;
+                for (long k = current + 1; k < windowStart + numSlots && next < 0; k++)
+                    for (int t = 0; t < nt; t++)
+                        if (!local[t][k % numSlots].empty()) {
+                            next = k;
+                            break;
+                        }
+                if (next < 0) {
+                    // Window empty: the next one starts at the lowest
+                    // overflow bucket and takes the entries that fall in it.
+                    for (int t = 0; t < nt; t++)
+                        for (size_t i = 0; i < overflow[t].size(); i++) {
+                            long b = (long)(dist[overflow[t][i]] / delta);
+                            if (b > current && (next < 0 || b < next))
+                                next = b;
+                        }
+                    for (int t = 0; next >= 0 && t < nt; t++) {
+                        size_t kept = 0;
+                        for (size_t i = 0; i < overflow[t].size(); i++) {
+                            int v = overflow[t][i];
+                            long b = (long)(dist[v] / delta);
+                            if (b <= current)
+                                continue;
+                            if (b < next + numSlots)
+                                local[t][b % numSlots].push_back(v);
+                            else
+                                overflow[t][kept++] = v;
+                        }
+                        overflow[t].resize(kept);
+                    }
+                    if (next >= 0)
+                        windowStart = next;
+                }
+                current = next;
+                bucket.index = next;
+                bucket.lightPhases = 0;
+                bucket.settled = 0;
+                phaseStart = omp_get_wtime();
+            }
+            INSTR_END(PHASE_FRONTIER);
+            if (current < 0)
                 break;
+            int slot = (int)(current % numSlots);
+
+            for (;;) {
+                INSTR_BEGIN(PHASE_FRONTIER);
+                #pragma omp single
+                {
+                    offset[0] = 0;
+                    for (int t = 0; t < nt; t++)
+                        offset[t + 1] = offset[t] + local[t][slot].size();
+                    frontierSize = offset[nt];
+                    if ((long)frontier.size() < frontierSize)
+                        frontier.resize(frontierSize);
+                    if (frontierSize)
+                        bucket.lightPhases++;
+                }
+                if (frontierSize == 0) {
+                    INSTR_END(PHASE_FRONTIER);
+                    break;
+                }
+
+                std::copy(mine[slot].begin(), mine[slot].end(), frontier.begin() + offset[tid]);
+                mine[slot].clear();
+                INSTR_END(PHASE_FRONTIER);
+                INSTR_BEGIN(PHASE_BARRIER);
+                #pragma omp barrier
+                INSTR_END(PHASE_BARRIER);
+
+                INSTR_BEGIN(PHASE_RELAX);
+                #pragma omp for schedule(dynamic, 64) nowait
+                for (long i = 0; i < frontierSize; i++) {
+                    int v = frontier[i];
+                    Dist d = atomicLoad(&dist[v]);
+                    // Stale entry: v has been settled in an earlier bucket.
+                    if ((long)(d / delta) != current)
+                        continue;
+                    // Duplicate entry: v's light edges were already relaxed at d.
+                    Dist previous;
+                    __atomic_exchange(&lastRelaxed[v], &d, &previous, __ATOMIC_RELAXED);
+                    if (previous == d)
+                        continue;
+                    if (testAndSetFlag(&inSettled[v]))
+                        settled[tid].push_back(v);
+                    INSTR_COUNT(COUNT_RELAXATIONS, edges.lightEnd[v] - g.indexofNodes[v]);
+                    for (long e = g.indexofNodes[v]; e < edges.lightEnd[v]; e++) {
+                        int u = edges.nbr[e];
+                        Dist nd = T::add(d, edges.len[e]);
+                        if (nd < atomicLoad(&dist[u]) && atomicMin(&dist[u], nd)) {
+                            INSTR_COUNT(COUNT_UPDATES, 1);
+                            long b = (long)(nd / delta);
+                            if (b < windowStart + numSlots)
+                                mine[b % numSlots].push_back(u);
+                            else
+                                overflow[tid].push_back(u);
+                        }
+                    }
+                }
+                INSTR_END(PHASE_RELAX);
+                INSTR_BEGIN(PHASE_BARRIER);
+                #pragma omp barrier
+                INSTR_END(PHASE_BARRIER);
             }
-        }
-    }
 
-    bool empty() {
-        for (auto& bucket : buckets) {
-            if (!bucket.empty()) {
-                return false;
+            #pragma omp single
+            {
+                double now = omp_get_wtime();
+                bucket.lightTime = now - phaseStart;
+                phaseStart = now;
+            }
+
+            // Settled vertices have their final distance; relax heavy edges once.
+            INSTR_BEGIN(PHASE_RELAX);
+            for (size_t i = 0; i < settled[tid].size(); i++) {
+                int v = settled[tid][i];
+                Dist d = atomicLoad(&dist[v]);
+                inSettled[v] = 0;
+                INSTR_COUNT(COUNT_RELAXATIONS, g.indexofNodes[v + 1] - edges.lightEnd[v]);
+                for (long e = edges.lightEnd[v]; e < g.indexofNodes[v + 1]; e++) {
+                    int u = edges.nbr[e];
+                    Dist nd = T::add(d, edges.len[e]);
+                    if (nd < atomicLoad(&dist[u]) && atomicMin(&dist[u], nd)) {
+                        INSTR_COUNT(COUNT_UPDATES, 1);
+                        long b = (long)(nd / delta);
+                        if (b < windowStart + numSlots)
+                            mine[b % numSlots].push_back(u);
+                        else
+                            overflow[tid].push_back(u);
+                    }
+                }
+            }
+            INSTR_END(PHASE_RELAX);
+            #pragma omp atomic
+            bucket.settled += settled[tid].size();
+            settled[tid].clear();
+            INSTR_BEGIN(PHASE_BARRIER);
+            #pragma omp barrier
+            INSTR_END(PHASE_BARRIER);
+
+            #pragma omp single
+            {
+                bucket.heavyTime = omp_get_wtime() - phaseStart;
+                if (stats)
+                    stats->push_back(bucket);
             }
         }
-        return true;
     }
+}
+
+struct DeltaRun {
+    graph* g;
+    int* weight;
+    int* dist;
+    int src;
+    int delta;
 };
 
-void Compute_SSSP(graph& g, int* weight, int* dist, int src, int delta) {
-    int num_nodes = g.num_nodes();
-    std::vector<int> distances(num_nodes, INF);
-    Bucket bucket(num_nodes, delta);
+static void runDeltaStepping(void* arg) {
+    DeltaRun* r = (DeltaRun*)arg;
+    Compute_SSSP(*r->g, r->weight, r->dist, r->src, r->delta, NULL);
+}
 
-    distances[src] = 0;
-    bucket.insert(src, 0);
+template <typename Dist>
+struct TypedRun {
+    graph* g;
+    std::vector<Dist> weight;
+    std::vector<Dist> dist;
+    int src;
+    int delta;
+};
 
-    while (!bucket.empty()) {
-        std::vector<int> minBucket = bucket.getMinBucket();
-        bucket.clearMinBucket();
+template <typename Dist>
+static void runDeltaSteppingTyped(void* arg) {
+    TypedRun<Dist>* r = (TypedRun<Dist>*)arg;
+    Compute_SSSP(*r->g, &r->weight[0], &r->dist[0], r->src, r->delta, NULL);
+}
 
-        std::vector<std::pair<int, int>> buffer;
+// Delta-stepping with weights and distances narrowed to Dist, checked
+// against the int distances in expected.
+template <typename Dist>
+static void benchDeltaSteppingTyped(BenchConfig* cfg, graph& g, int src, int delta, const char* input,
+                                    const int* expected) {
+    TypedRun<Dist> run;
+    run.g = &g;
+    run.weight.resize(g.num_edges() + 1);
+    run.dist.resize(g.num_nodes() + 1);
+    run.src = src;
+    run.delta = delta;
+    distConvert(g.getEdgeLen(), &run.weight[0], g.num_edges());
+    char kernel[64];
+    snprintf(kernel, sizeof(kernel), "delta-stepping-%s", dist_type_name(DistTraits<Dist>::type));
+    bench_run(cfg, kernel, input, NULL, runDeltaSteppingTyped<Dist>, &run, 0, NULL);
+    long mismatches = distMismatches(&run.dist[0], expected, g.num_nodes());
+    if (mismatches)
+        printf("  %s DISTANCES DIFFER for %ld vertices\n", dist_type_name(DistTraits<Dist>::type), mismatches);
+}
 
-        #pragma omp parallel for
-        for (int i = 0; i < minBucket.size(); ++i) {
-            int u = minBucket[i];
-            for (int edge = g.indexofNodes[u]; edge < g.indexofNodes[u + 1]; ++edge) {
-                int v = g.edgeList[edge];
-                int new_dist = distances[u] + weight[edge];
-                #pragma omp critical
-                {
-                    if (new_dist < distances[v]) {
-                        distances[v] = new_dist;
-                        buffer.push_back(std::make_pair(v, new_dist / delta));
-                    }
-                }
-            }
-        }
+// Largest update batch of the dynamic benchmark; batches grow tenfold from 1.
+const long MAX_BATCH = 100000;
 
-        for (auto& entry : buffer) {
-            bucket.insert(entry.first, entry.second * delta);
+static unsigned long long nextRandom(unsigned long long* state) {
+    unsigned long long z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Half insertions between random vertices, a quarter deletions and a
+// quarter reweightings of random existing edges; weights in [1, maxWeight].
+static std::vector<EdgeUpdate> randomBatch(const DynamicGraph& dg, long size, int maxWeight,
+                                           unsigned long long* seed) {
+    const DynamicAdjacency& out = dg.out;
+    std::vector<EdgeUpdate> batch;
+    for (long i = 0; i < size; i++) {
+        EdgeUpdate up;
+        up.kind = i % 4 < 2 ? EDGE_INSERT : i % 4 == 2 ? EDGE_DELETE : EDGE_WEIGHT;
+        up.weight = 1 + (int)(nextRandom(seed) % maxWeight);
+        up.u = (int)(nextRandom(seed) % dg.num_nodes());
+        up.v = (int)(nextRandom(seed) % dg.num_nodes());
+        if (up.kind != EDGE_INSERT && !out.nbr.empty()) {
+            for (int tries = 0; tries < 16; tries++) {
+                long e = (long)(nextRandom(seed) % out.nbr.size());
+                if (out.len[e] == DynamicAdjacency::DELETED_EDGE)
+                    continue;
+                up.u = (int)(std::upper_bound(out.index.begin(), out.index.end(), e) - out.index.begin() - 1);
+                up.v = out.nbr[e];
+                break;
+            }
         }
+        batch.push_back(up);
     }
+    return batch;
+}
 
-    #pragma omp parallel for
-    for (int i = 0; i < num_nodes; ++i) {
-        dist[i] = distances[i];
+static double median(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    return v.size() % 2 ? v[v.size() / 2] : (v[v.size() / 2 - 1] + v[v.size() / 2]) / 2;
+}
+
+// Applies random batches of growing size to a dynamic copy of the graph and
+// compares repairing the maintained distances with rebuilding the CSR and
+// rerunning delta-stepping; every repair is checked against the rerun.
+static void runDynamic(graph& G, bool undirected, int src, int delta, int reps) {
+    int maxWeight = 1;
+    for (long e = 0; e < G.num_edges(); e++)
+        maxWeight = std::max(maxWeight, G.getEdgeLen()[e]);
+
+    DynamicGraph dg(G.csr(), G.reverse(), undirected);
+    DynamicSSSP sssp(dg, src);
+    std::vector<int> repaired(G.num_nodes()), full(G.num_nodes());
+    unsigned long long seed = 1;
+
+    printf("Dynamic updates at %d threads, %d batches per size\n", omp_get_max_threads(), reps);
+    printf("%8s %12s %10s %10s %12s %14s %9s\n", "Batch", "Repair (s)", "Affected", "Seeds",
+           "Rebuild (s)", "Recompute (s)", "Speedup");
+    for (long size = 1; size <= MAX_BATCH && size <= std::max(1L, G.num_edges() / 10); size *= 10) {
+        std::vector<double> repair, rebuild, recompute;
+        long affected = 0, seeds = 0, mismatches = 0;
+        for (int r = 0; r < reps; r++) {
+            std::vector<EdgeUpdate> batch = randomBatch(dg, size, maxWeight, &seed);
+            double start = omp_get_wtime();
+            sssp.update(batch);
+            repair.push_back(omp_get_wtime() - start);
+            affected += sssp.lastAffected;
+            seeds += sssp.lastSeeds;
+
+            start = omp_get_wtime();
+            Graph csr;
+            dg.snapshot(&csr);
+            graph snapshot("snapshot");
+            snapshot.adopt(&csr);
+            rebuild.push_back(omp_get_wtime() - start);
+            start = omp_get_wtime();
+            Compute_SSSP(snapshot, snapshot.getEdgeLen(), &full[0], src, delta, NULL);
+            recompute.push_back(omp_get_wtime() - start);
+
+            sssp.distances(&repaired[0]);
+            for (int v = 0; v < G.num_nodes(); v++)
+                if (repaired[v] != full[v])
+                    mismatches++;
+        }
+        // Every tree edge must explain its child's distance.
+        for (int v = 0; v < G.num_nodes(); v++) {
+            int p = sssp.parent(v);
+            if (v != src && sssp.dist(v) != INF && (p < 0 || sssp.dist(p) + dg.out.weight(p, v) != sssp.dist(v)))
+                mismatches++;
+        }
+        double fullTime = median(rebuild) + median(recompute);
+        printf("%8ld %12.6f %10ld %10ld %12.6f %14.6f %8.1fx%s\n", size, median(repair), affected / reps,
+               seeds / reps, median(rebuild), median(recompute), fullTime / median(repair),
+               mismatches ? "  DISTANCES DIFFER" : "");
     }
 }
 
-int main() {
-    graph G("../../dataRecords/as-skitter.txt");
+int main(int argc, char* argv[]) {
+    const char* path;
+    bool undirected;
+    BenchConfig cfg;
+
+    // e.g. ../../dataRecords/as-skitter.txt [directed|undirected] [delta|auto] [bucket stats csv] --threads 1-16 --reorder gorder
+    bench_parse_args(&argc, argv, &cfg);
+    parse_graph_args(argc, argv, &path, &undirected, false);
+    graph G(path, undirected);
     G.parseGraph();
 
-    int* edgeLen = G.getEdgeLen();
     int* dist = new int[G.num_nodes() + 1];
 
-    int src = 1;
-    int delta = 100;  // Example delta value
+    // Buckets are indexed by distance / delta, so a negative weight would
+    // index before the first bucket.
+    const int* weights = G.getEdgeLen();
+    for (long e = 0; e < G.num_edges(); e++)
+        if (weights[e] < 0) {
+            fprintf(stderr, "Error: Delta-stepping needs non-negative edge weights\n");
+            return 1;
+        }
+
+    int delta = argc > 3 && strcmp(argv[3], "auto") != 0 ? atoi(argv[3]) : chooseDelta(G, G.getEdgeLen());
+    if (delta <= 0) {
+        fprintf(stderr, "Error: delta must be positive\n");
+        return 1;
+    }
+    printf("Delta : %d\n", delta);
+
+    // With --reorder everything below runs on the relabelled graph from the
+    // same source vertex; distances are printed by original id at the end.
+    int* perm = NULL;
+    char input[512];
+    snprintf(input, sizeof(input), "%s", path);
+    if (cfg.reorder != NULL) {
+        int kind = parse_reorder(cfg.reorder);
+        int* reordered = new int[G.num_nodes() + 1];
+        // The second of two runs is timed, so neither side pays for page
+        // faults and cold caches.
+        double before = 0, after = 0;
+        for (int rep = 0; rep < 2; rep++) {
+            double startTime = omp_get_wtime();
+            Compute_SSSP(G, G.getEdgeLen(), dist, 1, delta, NULL);
+            before = omp_get_wtime() - startTime;
+        }
+        ReorderStats reorderStats;
+        perm = G.reorder(kind, &reorderStats);
+        for (int rep = 0; rep < 2; rep++) {
+            double startTime = omp_get_wtime();
+            Compute_SSSP(G, G.getEdgeLen(), reordered, reorder_id(perm, 1), delta, NULL);
+            after = omp_get_wtime() - startTime;
+        }
+        int mismatches = 0;
+        for (int i = 0; i < G.num_nodes(); i++)
+            if (reordered[reorder_id(perm, i)] != dist[i])
+                mismatches++;
+        if (kind != REORDER_NONE)
+            reorder_report(&reorderStats, "delta-stepping", before, after);
+        if (mismatches)
+            printf("  REORDERED DISTANCES DIFFER for %d vertices\n", mismatches);
+        snprintf(input, sizeof(input), "%s, %s order", path, reorder_name(kind));
+        delete[] reordered;
+    }
+
+    int* edgeLen = G.getEdgeLen();
+    int src = reorder_id(perm, 1);
+
+    std::vector<BucketStats> stats;
     double startTime = omp_get_wtime();
-    Compute_SSSP(G, edgeLen, dist, src, delta);
+    Compute_SSSP(G, edgeLen, dist, src, delta, &stats);
     double endTime = omp_get_wtime();
     printf("RunTime : %f\n", endTime - startTime);
 
-    for (int i = 0; i < 10; ++i) {
-        printf("%d  %d\n", i, dist[i]);
+    double lightTime = 0, heavyTime = 0;
+    long phases = 0;
+    for (size_t i = 0; i < stats.size(); i++) {
+        lightTime += stats[i].lightTime;
+        heavyTime += stats[i].heavyTime;
+        phases += stats[i].lightPhases;
+    }
+    printf("Buckets : %zu, light phases : %ld, light time : %f, heavy time : %f\n",
+           stats.size(), phases, lightTime, heavyTime);
+
+    if (argc > 4) {
+        FILE* out = fopen(argv[4], "w");
+        if (out == NULL) {
+            fprintf(stderr, "Error: Could not open file %s\n", argv[4]);
+            return 1;
+        }
+        fprintf(out, "bucket,light_phases,settled,light_sec,heavy_sec\n");
+        for (size_t i = 0; i < stats.size(); i++)
+            fprintf(out, "%ld,%d,%ld,%.9f,%.9f\n", stats[i].index, stats[i].lightPhases,
+                    stats[i].settled, stats[i].lightTime, stats[i].heavyTime);
+        fclose(out);
+    }
+
+    DeltaRun run = { &G, edgeLen, dist, src, delta };
+    bench_run(&cfg, "delta-stepping", input, NULL, runDeltaStepping, &run, 0, NULL);
+
+    // Again on the narrowest distance type that holds every shortest path
+    int minWeight = 0, maxWeight = 0;
+    for (long e = 0; e < G.num_edges(); e++) {
+        minWeight = std::min(minWeight, edgeLen[e]);
+        maxWeight = std::max(maxWeight, edgeLen[e]);
+    }
+    switch (dist_type_for(minWeight, maxWeight, G.num_nodes())) {
+    case DIST_U8:  benchDeltaSteppingTyped<uint8_t>(&cfg, G, src, delta, input, dist); break;
+    case DIST_U16: benchDeltaSteppingTyped<uint16_t>(&cfg, G, src, delta, input, dist); break;
+    case DIST_I64: benchDeltaSteppingTyped<int64_t>(&cfg, G, src, delta, input, dist); break;
+    default:       benchDeltaSteppingTyped<int32_t>(&cfg, G, src, delta, input, dist);
+    }
+
+    if (INSTR_ENABLED) {
+        instr_reset();
+        runDeltaStepping(&run);
+        instr_report("delta-stepping");
+    }
+
+    int maxThreads = 1;
+    for (int i = 0; i < cfg.num_thread_counts; i++)
+        maxThreads = std::max(maxThreads, cfg.threads[i]);
+    omp_set_num_threads(maxThreads);
+    runDynamic(G, undirected, src, delta, cfg.reps);
+
+    for (int i = 0; i < 10 && i < G.num_nodes(); ++i) {
+        printf("%d  %d\n", i, dist[reorder_id(perm, i)]);
     }
 
+    free(perm);
     delete[] dist;
     return 0;
 }
@@ -4,19 +4,36 @@
 #include <limits.h>
 #include <stdbool.h>
 
-#define MAX_NODES 36692
-#define INF INT_MAX
-
-typedef struct {
-    int dst;
-    int weight;
-} Edge;
-
-typedef struct {
-    int num_edges;
-    Edge* edges;
-} Node;
+#include "bench.h"
+#include "graph_io.h"
+#include "graph_reorder.h"
+#include "graph_compress.h"
+#include "atomicUtil.h"
+#include "heap.h"
+#include "dist_types.h"
+#include "sssp.h"
+#include "instrument.h"
 
+#define INF INT_MAX
+#define HEAP_ARITY 4
+#define PARALLEL_RELAX_DEGREE 2048
+
+// dijkstra_u8, dijkstra_u16, ...: the heap kernel per distance type
+#define DIST_TYPE DIST_U8
+#include "dijkstra_kernel.h"
+#define DIST_TYPE DIST_U16
+#include "dijkstra_kernel.h"
+#define DIST_TYPE DIST_I32
+#include "dijkstra_kernel.h"
+#define DIST_TYPE DIST_I64
+#include "dijkstra_kernel.h"
+#define BATCH_QUERIES 1024
+#define POINT_QUERIES 1000
+// Point queries checked against a full single-source run.
+#define POINT_CHECKS 16
+
+// Previous heap with a linear-scan decrease_key, kept as the benchmark
+// baseline for the indexed heap in heap.h.
 typedef struct {
     int node;
     int dist;
@@ -28,31 +45,6 @@ typedef struct {
     int capacity;
 } MinHeap;
 
-Node* graph[MAX_NODES];
-
-void initialize_graph() {
-    for (int i = 0; i < MAX_NODES; i++) {
-        graph[i] = (Node*)malloc(sizeof(Node));
-        if (graph[i] == NULL) {
-            fprintf(stderr, "Error: Could not allocate memory for graph node %d\n", i);
-            exit(EXIT_FAILURE);
-        }
-        graph[i]->num_edges = 0;
-        graph[i]->edges = NULL;
-    }
-}
-
-void add_edge(int src, int dst, int weight) {
-    graph[src]->num_edges++;
-    graph[src]->edges = (Edge*)realloc(graph[src]->edges, graph[src]->num_edges * sizeof(Edge));
-    if (graph[src]->edges == NULL) {
-        fprintf(stderr, "Error: Could not allocate memory for edges of node %d\n", src);
-        exit(EXIT_FAILURE);
-    }
-    graph[src]->edges[graph[src]->num_edges - 1].dst = dst;
-    graph[src]->edges[graph[src]->num_edges - 1].weight = weight;
-}
-
 MinHeap* create_min_heap(int capacity) {
     MinHeap* minHeap = (MinHeap*)malloc(sizeof(MinHeap));
     minHeap->nodes = (HeapNode*)malloc(capacity * sizeof(HeapNode));
@@ -109,86 +101,620 @@ void decrease_key(MinHeap* minHeap, int node, int dist) {
     }
 }
 
-void dijkstra(int src, int dist[]) {
-    bool visited[MAX_NODES];
-    MinHeap* minHeap = create_min_heap(MAX_NODES);
+void dijkstra_scan_heap(const Graph* g, int src, int dist[]) {
+    int n = g->num_nodes;
+    bool* visited = (bool*)graph_malloc(n * sizeof(bool), "visited flags");
+    unsigned char* queued = (unsigned char*)graph_malloc(n, "improved flags");
+    int* improved = (int*)graph_malloc(n * sizeof(int), "improved vertices");
+    MinHeap* minHeap = create_min_heap(n);
 
-    for (int i = 0; i < MAX_NODES; i++) {
+    for (int i = 0; i < n; i++) {
         dist[i] = INF;
         visited[i] = false;
+        queued[i] = 0;
         minHeap->nodes[i].node = i;
         minHeap->nodes[i].dist = INF;
     }
     dist[src] = 0;
-    minHeap->nodes[src].dist = 0;
-    minHeap->size = MAX_NODES;
+    minHeap->size = n;
+    decrease_key(minHeap, src, 0);
 
     while (minHeap->size) {
+        INSTR_BEGIN(PHASE_EXTRACT_MIN);
         HeapNode minHeapNode = extract_min(minHeap);
+        INSTR_END(PHASE_EXTRACT_MIN);
+        INSTR_COUNT(COUNT_HEAP_OPS, 1);
         int u = minHeapNode.node;
 
         if (visited[u])
             continue;
 
         visited[u] = true;
-
+        INSTR_COUNT(COUNT_RELAXATIONS, out_degree(g, u));
+
+        // Relaxations race only on dist, through atomicMin; the flag lets
+        // each improved vertex into the list once, and the heap is updated
+        // from the list after the loop instead of under a lock.
+        INSTR_BEGIN(PHASE_RELAX);
+        int du = dist[u];
+        long changed = 0;
         #pragma omp parallel for
-        for (int i = 0; i < graph[u]->num_edges; i++) {
-            int v = graph[u]->edges[i].dst;
-            int weight = graph[u]->edges[i].weight;
-
-            if (!visited[v] && dist[u] != INF && dist[u] + weight < dist[v]) {
-                #pragma omp critical
-                {
-                    if (dist[u] + weight < dist[v]) {
-                        dist[v] = dist[u] + weight;
-                        decrease_key(minHeap, v, dist[v]);
-                    }
-                }
+        for (long i = g->indexofNodes[u]; i < g->indexofNodes[u + 1]; i++) {
+            int v = g->edgeList[i];
+            int weight = g->edgeLen[i];
+
+            if (!visited[v] && du != INF && du + weight < dist[v] && atomicMin(&dist[v], du + weight)) {
+                INSTR_COUNT(COUNT_UPDATES, 1);
+                if (testAndSetFlag(&queued[v]))
+                    improved[__atomic_fetch_add(&changed, 1, __ATOMIC_RELAXED)] = v;
             }
         }
+        for (long i = 0; i < changed; i++) {
+            int v = improved[i];
+            queued[v] = 0;
+            decrease_key(minHeap, v, dist[v]);
+        }
+        INSTR_COUNT(COUNT_HEAP_OPS, changed);
+        INSTR_END(PHASE_RELAX);
     }
     free(minHeap->nodes);
     free(minHeap);
+    free(visited);
+    free(queued);
+    free(improved);
 }
 
-int main(int argc, char* argv[]) {
-    initialize_graph();
+// Dijkstra with an indexed d-ary heap on int distances: the i32 stamp of
+// dijkstra_kernel.h over the graph's own weights.
+void dijkstra(const Graph* g, int src, int dist[], int arity) {
+    dijkstra_i32(g, g->edgeLen, src, dist, arity);
+}
 
-    // Read edges from Email-Enron.txt
-    FILE *file = fopen("/home/graphfiles/Email-Enron.txt", "r");
-    if (file == NULL) {
-        fprintf(stderr, "Error: Could not open file Email-Enron.txt\n");
-        return 1;
-    }
+// dijkstra() over the byte-coded adjacency of graph_compress.h. Lists are
+// decoded as they are relaxed, so hubs are relaxed serially as well. The
+// body is inlined once per weight width, so the decode loop does not
+// dispatch on it per edge.
+static inline __attribute__((always_inline)) void dijkstra_compressed_width(
+    const CompressedGraph* cg, int src, int dist[], int arity, int weight_bytes) {
+    int n = cg->num_nodes;
+    IndexedHeap* heap = heap_create(n, arity);
+
+    #pragma omp parallel for
+    for (int i = 0; i < n; i++)
+        dist[i] = INF;
 
-    int src, dst;
-    while (fscanf(file, "%d\t%d", &src, &dst) != EOF) {
-        if (src >= MAX_NODES || dst >= MAX_NODES) {
-            fprintf(stderr, "Error: Node index out of bounds (src: %d, dst: %d)\n", src, dst);
-            continue; // Skip invalid edges
+    dist[src] = 0;
+    heap_push_or_decrease(heap, src, 0);
+
+    while (!heap_empty(heap)) {
+        INSTR_BEGIN(PHASE_EXTRACT_MIN);
+        int u = heap_pop(heap).node;
+        INSTR_END(PHASE_EXTRACT_MIN);
+        INSTR_COUNT(COUNT_HEAP_OPS, 1);
+        int du = dist[u];
+
+        INSTR_BEGIN(PHASE_RELAX);
+        CgEdgeIter it;
+        int v, weight;
+        cg_edges(cg, u, &it);
+        INSTR_COUNT(COUNT_RELAXATIONS, it.left);
+        while (cg_next_width(&it, &v, &weight, weight_bytes)) {
+            int nd = du + weight;
+            if (nd < dist[v]) {
+                dist[v] = nd;
+                heap_push_or_decrease(heap, v, nd);
+                INSTR_COUNT(COUNT_UPDATES, 1);
+                INSTR_COUNT(COUNT_HEAP_OPS, 1);
+            }
         }
-        add_edge(src, dst, 1);
+        INSTR_END(PHASE_RELAX);
+    }
+
+    heap_free(heap);
+}
+
+void dijkstra_compressed(const CompressedGraph* cg, int src, int dist[], int arity) {
+    switch (cg->weight_bytes) {
+    case 1:  dijkstra_compressed_width(cg, src, dist, arity, 1); break;
+    case 2:  dijkstra_compressed_width(cg, src, dist, arity, 2); break;
+    default: dijkstra_compressed_width(cg, src, dist, arity, 4);
+    }
+}
+
+// Reads every edge once into a checksum: what a layout costs to traverse
+// with no kernel around it.
+static long scan_csr(const Graph* g) {
+    long sum = 0;
+    #pragma omp parallel for schedule(dynamic, 1024) reduction(+:sum)
+    for (int u = 0; u < g->num_nodes; u++)
+        for (long i = g->indexofNodes[u]; i < g->indexofNodes[u + 1]; i++)
+            sum += g->edgeList[i] + g->edgeLen[i];
+    return sum;
+}
+
+static inline __attribute__((always_inline)) long scan_compressed_width(const CompressedGraph* cg,
+                                                                        int weight_bytes) {
+    long sum = 0;
+    #pragma omp parallel for schedule(dynamic, 1024) reduction(+:sum)
+    for (int u = 0; u < cg->num_nodes; u++) {
+        CgEdgeIter it;
+        int v, weight;
+        for (cg_edges(cg, u, &it); cg_next_width(&it, &v, &weight, weight_bytes); )
+            sum += v + weight;
+    }
+    return sum;
+}
+
+static long scan_compressed(const CompressedGraph* cg) {
+    switch (cg->weight_bytes) {
+    case 1:  return scan_compressed_width(cg, 1);
+    case 2:  return scan_compressed_width(cg, 2);
+    default: return scan_compressed_width(cg, 4);
+    }
+}
+
+typedef struct {
+    const Graph* g;
+    const CompressedGraph* cg;
+    long sum;
+} ScanRun;
+
+static void run_scan(void* arg) {
+    ScanRun* r = (ScanRun*)arg;
+    r->sum = r->cg ? scan_compressed(r->cg) : scan_csr(r->g);
+}
+
+typedef struct {
+    const Graph* g;
+    int src;
+    int* dist;
+} DijkstraRun;
+
+static void run_dijkstra(void* arg) {
+    DijkstraRun* r = (DijkstraRun*)arg;
+    dijkstra(r->g, r->src, r->dist, HEAP_ARITY);
+}
+
+typedef struct {
+    const Graph* g;
+    int type;
+    void* weights;
+    int src;
+    void* dist;
+} TypedRun;
+
+static void run_dijkstra_typed(void* arg) {
+    TypedRun* r = (TypedRun*)arg;
+    switch (r->type) {
+    case DIST_U8:  dijkstra_u8(r->g, (const uint8_t*)r->weights, r->src, (uint8_t*)r->dist, HEAP_ARITY); break;
+    case DIST_U16: dijkstra_u16(r->g, (const uint16_t*)r->weights, r->src, (uint16_t*)r->dist, HEAP_ARITY); break;
+    case DIST_I64: dijkstra_i64(r->g, (const int64_t*)r->weights, r->src, (int64_t*)r->dist, HEAP_ARITY); break;
+    default:       dijkstra_i32(r->g, (const int32_t*)r->weights, r->src, (int32_t*)r->dist, HEAP_ARITY);
     }
-    fclose(file);
+}
+
+static void* typed_weights(const Graph* g, int type) {
+    switch (type) {
+    case DIST_U8:  return dist_weights_u8(g);
+    case DIST_U16: return dist_weights_u16(g);
+    case DIST_I64: return dist_weights_i64(g);
+    default:       return dist_weights_i32(g);
+    }
+}
+
+static long typed_mismatches(const TypedRun* r, const int* expected) {
+    int n = r->g->num_nodes;
+    switch (r->type) {
+    case DIST_U8:  return dist_mismatches_u8((const uint8_t*)r->dist, expected, n);
+    case DIST_U16: return dist_mismatches_u16((const uint16_t*)r->dist, expected, n);
+    case DIST_I64: return dist_mismatches_i64((const int64_t*)r->dist, expected, n);
+    default:       return dist_mismatches_i32((const int32_t*)r->dist, expected, n);
+    }
+}
 
-    for (int num_threads = 16; num_threads >= 1; num_threads--) {
-        omp_set_num_threads(num_threads);
+typedef struct {
+    SsspSolver* solver;
+    int src;
+    int* dist;
+} SolveRun;
+
+static void run_solve(void* arg) {
+    SolveRun* r = (SolveRun*)arg;
+    sssp_solve(r->solver, r->src, r->dist);
+}
 
-        double start_time = omp_get_wtime();
+typedef struct {
+    const Graph* g;
+    int src;
+    int* dist;
+    SsspMqStats stats;
+} MultiQueueRun;
+
+static void run_multiqueue(void* arg) {
+    MultiQueueRun* r = (MultiQueueRun*)arg;
+    sssp_multiqueue(r->g, r->src, r->dist, &r->stats);
+}
 
-        int dist[MAX_NODES];
-        dijkstra(0, dist);
+typedef struct {
+    const CompressedGraph* cg;
+    int src;
+    int* dist;
+} CompressedRun;
+
+static void run_dijkstra_compressed(void* arg) {
+    CompressedRun* r = (CompressedRun*)arg;
+    dijkstra_compressed(r->cg, r->src, r->dist, HEAP_ARITY);
+}
+
+typedef struct {
+    SsspBatch* batch;
+    const int* sources;
+    int count;
+    int mode;
+    double* latency;
+} BatchRun;
+
+static void run_batch(void* arg) {
+    BatchRun* r = (BatchRun*)arg;
+    sssp_batch_run(r->batch, r->sources, r->count, r->mode, NULL, NULL, r->latency);
+}
+
+// Sum of the finite distances plus the number of reached vertices, so rows
+// from different batch modes can be compared without keeping them.
+static long row_checksum(const int* dist, int n) {
+    long sum = 0;
+    for (int v = 0; v < n; v++)
+        if (dist[v] != INF)
+            sum += (long)dist[v] + 1;
+    return sum;
+}
+
+typedef struct {
+    long* sums;
+    int n;
+} ChecksumRun;
+
+static void checksum_row(int query, int src, const int* dist, void* arg) {
+    ChecksumRun* r = (ChecksumRun*)arg;
+    (void)src;
+    r->sums[query] = row_checksum(dist, r->n);
+}
+
+// Prints queries/s and latency percentiles of one batch; latency is sorted
+// in place.
+static void print_batch(const char* name, int count, int intra, double elapsed, double* latency) {
+    qsort(latency, count, sizeof(double), bench_compare_double);
+    printf("  %-6s (in sec): %.4f, %.1f queries/s, %d intra-query, latency (ms) p50 %.3f p95 %.3f p99 %.3f max %.3f\n",
+           name, elapsed, count / elapsed, intra, 1e3 * latency[count / 2],
+           1e3 * latency[(long)count * 95 / 100], 1e3 * latency[(long)count * 99 / 100],
+           1e3 * latency[count - 1]);
+}
 
+typedef struct {
+    SsspPointQuery* query;
+    const int* pairs;
+    int count;
+    bool bidirectional;
+    int* results;
+} PointRun;
+
+static void run_points(void* arg) {
+    PointRun* r = (PointRun*)arg;
+    for (int i = 0; i < r->count; i++) {
+        int s = r->pairs[2 * i], t = r->pairs[2 * i + 1];
+        r->results[i] = r->bidirectional ? sssp_point_query_bidirectional(r->query, s, t, NULL, NULL)
+                                         : sssp_point_query(r->query, s, t, NULL, NULL);
+    }
+}
+
+// Length of path along the lightest edge between consecutive vertices, or
+// -1 if some pair is not joined by an edge.
+static long path_weight(const Graph* g, const int* path, int len) {
+    long total = 0;
+    for (int i = 0; i + 1 < len; i++) {
+        int best = INF;
+        for (long e = g->indexofNodes[path[i]]; e < g->indexofNodes[path[i] + 1]; e++)
+            if (g->edgeList[e] == path[i + 1] && g->edgeLen[e] < best)
+                best = g->edgeLen[e];
+        if (best == INF)
+            return -1;
+        total += best;
+    }
+    return total;
+}
+
+int main(int argc, char* argv[]) {
+    Graph g;
+    const char* path;
+    bool undirected;
+    BenchConfig cfg;
+
+    // e.g. /home/graphfiles/Email-Enron.txt directed 4096 1000 --threads 16-1 --reps 10 --csv results.csv --reorder rcm
+    //      --numa interleave --bind spread
+    // The optional third and fourth arguments are the number of sources in
+    // the batch run and the number of s-t pairs in the point query run.
+    bench_parse_args(&argc, argv, &cfg);
+    parse_graph_args(argc, argv, &path, &undirected, false);
+    int queries = argc > 3 ? atoi(argv[3]) : BATCH_QUERIES;
+    int num_pairs = argc > 4 ? atoi(argv[4]) : POINT_QUERIES;
+    if (queries <= 0 || num_pairs <= 0) {
+        fprintf(stderr, "Error: Number of queries must be positive\n");
+        return 1;
+    }
+    open_graph(&g, path, undirected);
+
+    int* dist = (int*)graph_malloc(g.num_nodes * sizeof(int), "distances");
+    int* expected = (int*)graph_malloc(g.num_nodes * sizeof(int), "distances");
+
+    // With --reorder everything below runs on the relabelled graph; sources
+    // and query pairs are picked by original id and mapped through perm.
+    int* perm = NULL;
+    char input[512];
+    snprintf(input, sizeof(input), "%s", path);
+    if (cfg.reorder != NULL) {
+        int kind = parse_reorder(cfg.reorder);
+        // The second of two runs is timed, so neither side pays for page
+        // faults and cold caches.
+        double before = 0, after = 0;
+        for (int rep = 0; rep < 2; rep++) {
+            double start_time = omp_get_wtime();
+            dijkstra(&g, 0, dist, HEAP_ARITY);
+            before = omp_get_wtime() - start_time;
+        }
+        ReorderStats stats;
+        perm = reorder_graph(&g, kind, &stats);
+        for (int rep = 0; rep < 2; rep++) {
+            double start_time = omp_get_wtime();
+            dijkstra(&g, reorder_id(perm, 0), expected, HEAP_ARITY);
+            after = omp_get_wtime() - start_time;
+        }
+        int mismatches = 0;
+        for (int v = 0; v < g.num_nodes; v++)
+            if (expected[reorder_id(perm, v)] != dist[v])
+                mismatches++;
+        if (kind != REORDER_NONE)
+            reorder_report(&stats, "dijkstra-heap", before, after);
+        if (mismatches)
+            printf("  REORDERED DISTANCES DIFFER for %d vertices\n", mismatches);
+        snprintf(input, sizeof(input), "%s, %s order", path, reorder_name(kind));
+    }
+    int src = reorder_id(perm, 0);
+
+    // The graph is only read from here on; --numa interleave spreads it
+    // over the nodes, replicate gives the batch's inter-query searches a
+    // copy per node.
+    int policy = parse_numa_policy(cfg.numa);
+    GraphReplicas replicas;
+    numa_place_graph(&g, policy, &replicas);
+
+    double start_time = omp_get_wtime();
+    dijkstra_scan_heap(&g, src, expected);
+    double baseline_time = omp_get_wtime() - start_time;
+    printf("Total time for linear-scan heap (in sec): %.4f\n", baseline_time);
+
+    for (int arity = 2; arity <= 8; arity *= 2) {
+        start_time = omp_get_wtime();
+        dijkstra(&g, src, dist, arity);
         double elapsed_time = omp_get_wtime() - start_time;
-        printf("Total time for %d threads (in sec): %.2f\n", num_threads, elapsed_time);
+
+        int mismatches = 0;
+        for (int i = 0; i < g.num_nodes; i++)
+            if (dist[i] != expected[i])
+                mismatches++;
+        printf("Total time for indexed %d-ary heap (in sec): %.4f, speedup %.1fx%s\n", arity,
+               elapsed_time, baseline_time / elapsed_time, mismatches ? ", DISTANCES DIFFER" : "");
     }
 
-    // Free the graph memory
-    for (int i = 0; i < MAX_NODES; i++) {
-        free(graph[i]->edges);
-        free(graph[i]);
+    DijkstraRun run = { &g, src, dist };
+    bench_run(&cfg, "dijkstra-heap", input, NULL, run_dijkstra, &run, g.num_edges / 1e9, "GTEPS");
+
+    // The same heap kernel on the narrowest distance type that holds every
+    // shortest path, weights converted alongside.
+    int min_weight = 0, max_weight = 0;
+    #pragma omp parallel for reduction(min:min_weight) reduction(max:max_weight)
+    for (long e = 0; e < g.num_edges; e++) {
+        if (g.edgeLen[e] < min_weight)
+            min_weight = g.edgeLen[e];
+        if (g.edgeLen[e] > max_weight)
+            max_weight = g.edgeLen[e];
+    }
+    int type = dist_type_for(min_weight, max_weight, g.num_nodes);
+    TypedRun typed_run = { &g, type, typed_weights(&g, type), src,
+                           graph_malloc(g.num_nodes * sizeof(int64_t), "typed distances") };
+    char typed_name[64];
+    snprintf(typed_name, sizeof(typed_name), "dijkstra-heap-%s", dist_type_name(type));
+    bench_run(&cfg, typed_name, input, NULL, run_dijkstra_typed, &typed_run, g.num_edges / 1e9, "GTEPS");
+    long typed_diff = typed_mismatches(&typed_run, expected);
+    if (typed_diff)
+        printf("  %s DISTANCES DIFFER for %ld vertices\n", dist_type_name(type), typed_diff);
+    free(typed_run.weights);
+    free(typed_run.dist);
+
+    // The front end picks from the weights: a direction-optimizing BFS when
+    // all are equal (unweighted inputs load with weight 1), a bucket queue
+    // or radix heap for non-negative integers. Every kernel that applies is
+    // timed as well, the picked one first.
+    Graph rev;
+    transpose_graph(&g, &rev);
+    SsspSolver solver;
+    sssp_solver_init(&solver, &g, &rev);
+    int picked = solver.kernel;
+    printf("Front end picks %s (weights %d to %d)\n", sssp_kernel_name(picked), solver.min_weight,
+           solver.max_weight);
+    for (int k = -1; k < SSSP_KERNELS; k++) {
+        int kernel = k < 0 ? picked : k;
+        if ((k >= 0 && kernel == picked) || !sssp_kernel_applies(&solver, kernel))
+            continue;
+        solver.kernel = kernel;
+        SolveRun solve_run = { &solver, src, dist };
+        char solve_name[64];
+        snprintf(solve_name, sizeof(solve_name), "sssp-%s", sssp_kernel_name(kernel));
+        bench_run(&cfg, solve_name, input, NULL, run_solve, &solve_run, g.num_edges / 1e9, "GTEPS");
+        int solve_mismatches = 0;
+        for (int i = 0; i < g.num_nodes; i++)
+            if (dist[i] != expected[i])
+                solve_mismatches++;
+        if (kernel == SSSP_KERNEL_BFS)
+            printf("BFS: %d levels, %d bottom-up, %.2f edge checks per edge\n", solver.levels,
+                   solver.bottom_up_levels, (double)solver.examined / (g.num_edges ? g.num_edges : 1));
+        if (kernel == SSSP_KERNEL_DIAL || kernel == SSSP_KERNEL_RADIX)
+            printf("%s: %ld buckets, %ld stale entries\n", sssp_kernel_name(kernel), solver.buckets,
+                   solver.stale);
+        if (solve_mismatches)
+            printf("  %s DISTANCES DIFFER for %d vertices\n", sssp_kernel_name(kernel), solve_mismatches);
+    }
+    sssp_solver_free(&solver);
+
+    // Every thread pops and relaxes from a relaxed concurrent priority
+    // queue; the price is vertices scanned before their distance is final.
+    MultiQueueRun mq_run = { &g, src, dist, { 0, 0, 0, 0, 0, 0 } };
+    bench_run(&cfg, "sssp-multiqueue", input, NULL, run_multiqueue, &mq_run, g.num_edges / 1e9, "GTEPS");
+    int mq_mismatches = 0;
+    for (int i = 0; i < g.num_nodes; i++)
+        if (dist[i] != expected[i])
+            mq_mismatches++;
+    SsspMqStats* mq = &mq_run.stats;
+    printf("MultiQueue at %d threads: %ld pops, %.1f%% stale, %.3f scans per reached vertex, "
+           "%.3f relaxations per needed one\n", omp_get_max_threads(), mq->pops,
+           100.0 * mq->stale / (mq->pops ? mq->pops : 1), (double)mq->scans / (mq->reached ? mq->reached : 1),
+           (double)mq->relaxations / (mq->needed ? mq->needed : 1));
+    if (mq_mismatches)
+        printf("  MULTIQUEUE DISTANCES DIFFER for %d vertices\n", mq_mismatches);
+
+    // The same traversals over the byte-coded adjacency.
+    CompressedGraph cg;
+    start_time = omp_get_wtime();
+    compress_graph(&g, &cg);
+    double compress_time = omp_get_wtime() - start_time;
+    printf("Compressed adjacency: %.2f bytes/edge against %.2f for CSR (%d-byte weights), built in %.4f sec\n",
+           (double)compressed_bytes(&cg) / g.num_edges, (double)csr_bytes(&g) / g.num_edges,
+           cg.weight_bytes, compress_time);
+    ScanRun scan = { &g, NULL, 0 };
+    bench_run(&cfg, "edge-scan", input, NULL, run_scan, &scan, g.num_edges / 1e9, "Gedges/s");
+    ScanRun compressed_scan = { &g, &cg, 0 };
+    bench_run(&cfg, "edge-scan-compressed", input, NULL, run_scan, &compressed_scan, g.num_edges / 1e9,
+              "Gedges/s");
+    CompressedRun compressed_run = { &cg, src, dist };
+    bench_run(&cfg, "dijkstra-heap-compressed", input, NULL, run_dijkstra_compressed, &compressed_run,
+              g.num_edges / 1e9, "GTEPS");
+    int compressed_mismatches = 0;
+    for (int i = 0; i < g.num_nodes; i++)
+        if (dist[i] != expected[i])
+            compressed_mismatches++;
+    if (compressed_mismatches || scan.sum != compressed_scan.sum)
+        printf("  COMPRESSED TRAVERSAL DIFFERS (%d distances, edge checksum %ld vs %ld)\n",
+               compressed_mismatches, compressed_scan.sum, scan.sum);
+    free_compressed_graph(&cg);
+
+    // Batch of evenly spaced sources, the first being vertex 0.
+    int* sources = (int*)graph_malloc(queries * sizeof(int), "sources");
+    double* latency = (double*)graph_malloc(queries * sizeof(double), "latencies");
+    long* sums[3];
+    for (int q = 0; q < queries; q++)
+        sources[q] = reorder_id(perm, (int)((long)q * g.num_nodes / queries % g.num_nodes));
+    SsspBatch batch;
+    sssp_batch_init(&batch, &g);
+    batch.replicas = &replicas;
+    BatchRun batch_run = { &batch, sources, queries, SSSP_BATCH_AUTO, latency };
+    char batch_input[1024];
+    snprintf(batch_input, sizeof(batch_input), "%s, %d sources, %s", input, queries, numa_policy_name(policy));
+    bench_run(&cfg, "sssp-batch", batch_input, NULL, run_batch, &batch_run, queries, "queries/s");
+
+    static const char* mode_names[3] = { "auto", "inter", "intra" };
+    int max_threads = 1;
+    for (int i = 0; i < cfg.num_thread_counts; i++)
+        if (cfg.threads[i] > max_threads)
+            max_threads = cfg.threads[i];
+    omp_set_num_threads(max_threads);
+    printf("Batch of %d sources at %d threads:\n", queries, max_threads);
+    for (int mode = SSSP_BATCH_AUTO; mode <= SSSP_BATCH_INTRA; mode++) {
+        sums[mode] = (long*)graph_malloc(queries * sizeof(long), "checksums");
+        ChecksumRun check = { sums[mode], g.num_nodes };
+        start_time = omp_get_wtime();
+        int intra = sssp_batch_run(&batch, sources, queries, mode, checksum_row, &check, latency);
+        print_batch(mode_names[mode], queries, intra, omp_get_wtime() - start_time, latency);
     }
+    int batch_mismatches = sums[SSSP_BATCH_AUTO][0] != row_checksum(expected, g.num_nodes);
+    for (int q = 0; q < queries; q++)
+        if (sums[SSSP_BATCH_INTER][q] != sums[SSSP_BATCH_AUTO][q] ||
+            sums[SSSP_BATCH_INTRA][q] != sums[SSSP_BATCH_AUTO][q])
+            batch_mismatches++;
+    if (batch_mismatches)
+        printf("  BATCH DISTANCES DIFFER for %d sources\n", batch_mismatches);
+    for (int mode = SSSP_BATCH_AUTO; mode <= SSSP_BATCH_INTRA; mode++)
+        free(sums[mode]);
+    sssp_batch_free(&batch);
+    graph_replicas_free(&replicas);
+    free(latency);
+    free(sources);
+
+    // Point queries between pseudo-random pairs, one pair at a time.
+    SsspPointQuery point;
+    sssp_point_init(&point, &g, &rev);
+    int* pairs = (int*)graph_malloc(2 * num_pairs * sizeof(int), "query pairs");
+    int* point_dist = (int*)graph_malloc(num_pairs * sizeof(int), "distances");
+    int* bidir_dist = (int*)graph_malloc(num_pairs * sizeof(int), "distances");
+    for (int i = 0; i < 2 * num_pairs; i++) {
+        unsigned h = (unsigned)i * 2654435761u;
+        h ^= h >> 15;
+        h *= 2246822519u;
+        h ^= h >> 13;
+        pairs[i] = reorder_id(perm, (int)(h % (unsigned)g.num_nodes));
+    }
+    char point_input[1024];
+    snprintf(point_input, sizeof(point_input), "%s, %d pairs", input, num_pairs);
+    PointRun point_run = { &point, pairs, num_pairs, false, point_dist };
+    bench_run(&cfg, "sssp-point", point_input, NULL, run_points, &point_run, num_pairs, "queries/s");
+    PointRun bidir_run = { &point, pairs, num_pairs, true, bidir_dist };
+    bench_run(&cfg, "sssp-point-bidirectional", point_input, NULL, run_points, &bidir_run, num_pairs,
+              "queries/s");
+
+    // Distances agree between the two searches and, for the first pairs,
+    // with a full run; every returned path has the reported length.
+    int point_mismatches = 0;
+    long settled[2] = { 0, 0 };
+    int* path_buf = (int*)graph_malloc(g.num_nodes * sizeof(int), "path");
+    for (int i = 0; i < num_pairs; i++) {
+        int s = pairs[2 * i], t = pairs[2 * i + 1];
+        if (i < POINT_CHECKS) {
+            dijkstra(&g, s, dist, HEAP_ARITY);
+            if (dist[t] != point_dist[i])
+                point_mismatches++;
+        }
+        int len;
+        int d = sssp_point_query(&point, s, t, path_buf, &len);
+        settled[0] += point.side[0].settled;
+        if (d != point_dist[i] || d != bidir_dist[i] ||
+            (d != INF && (path_buf[0] != s || path_buf[len - 1] != t || path_weight(&g, path_buf, len) != d)))
+            point_mismatches++;
+        d = sssp_point_query_bidirectional(&point, s, t, path_buf, &len);
+        settled[1] += point.side[0].settled + point.side[1].settled;
+        if (d != INF && (path_buf[0] != s || path_buf[len - 1] != t || path_weight(&g, path_buf, len) != d))
+            point_mismatches++;
+    }
+    printf("Point queries: %.1f vertices settled per query with early termination, %.1f bidirectional%s\n",
+           (double)settled[0] / num_pairs, (double)settled[1] / num_pairs,
+           point_mismatches ? ", DISTANCES OR PATHS DIFFER" : "");
+    free(path_buf);
+    free(bidir_dist);
+    free(point_dist);
+    free(pairs);
+    sssp_point_free(&point);
+    free_graph(&rev);
+
+    if (INSTR_ENABLED) {
+        instr_reset();
+        dijkstra_scan_heap(&g, src, dist);
+        instr_report("dijkstra-scan-heap");
+        instr_reset();
+        dijkstra(&g, src, dist, HEAP_ARITY);
+        instr_report("dijkstra-heap");
+    }
+
+    free(perm);
+    free(expected);
+    free(dist);
+    free_graph(&g);
 
     return 0;
 }
\ No newline at end of file
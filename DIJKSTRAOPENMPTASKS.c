@@ -3,148 +3,257 @@
 #include <omp.h>
 #include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+#include "bench.h"
+#include "graph_io.h"
+#include "graph_reorder.h"
+#include "sssp.h"
+#include "instrument.h"
 
-#define MAX_NODES 36692
 #define INF INT_MAX
+#define PARALLEL_RELAX_DEGREE 1024
 
 typedef struct {
-    int dst;
-    int weight;
-} Edge;
+    int dist;
+    int node;
+} MinPair;
 
-typedef struct {
-    int num_edges;
-    int capacity;
-    Edge* edges;
-} Node;
-
-Node* graph[MAX_NODES];
-
-void initialize_graph() {
-    for (int i = 0; i < MAX_NODES; i++) {
-        graph[i] = (Node*)malloc(sizeof(Node));
-        if (graph[i] == NULL) {
-            fprintf(stderr, "Error: Could not allocate memory for graph node %d\n", i);
-            exit(EXIT_FAILURE);
-        }
-        graph[i]->num_edges = 0;
-        graph[i]->capacity = 4; // Initial capacity for edges
-        graph[i]->edges = (Edge*)malloc(graph[i]->capacity * sizeof(Edge));
-        if (graph[i]->edges == NULL) {
-            fprintf(stderr, "Error: Could not allocate memory for edges of node %d\n", i);
-            exit(EXIT_FAILURE);
-        }
+// Smallest distance wins, ties go to the lower vertex id so the order in
+// which vertices are settled does not depend on the thread count.
+#pragma omp declare reduction(minpair : MinPair : \
+    omp_out = (omp_in.dist < omp_out.dist || \
+               (omp_in.dist == omp_out.dist && omp_in.node < omp_out.node)) ? omp_in : omp_out) \
+    initializer(omp_priv = (MinPair){INF, -1})
+
+// Dense-selection Dijkstra: every round picks the closest unvisited vertex
+// with a parallel argmin over the whole distance array, so the run is
+// O(V^2 / p) regardless of the edge count. One thread team lives for the
+// whole run. key holds the tentative distance of every unsettled vertex and
+// INF for settled ones, so each 64-vertex block is a plain SIMD min; the
+// visited bitset lets fully settled blocks be skipped and keeps relaxations
+// off settled vertices.
+void dijkstra(const Graph* g, int src, int dist[]) {
+    int n = g->num_nodes;
+    long num_words = (n + 63) / 64;
+    uint64_t* visited = (uint64_t*)aligned_alloc(64, ((num_words * 8 + 63) / 64) * 64);
+    int* key = (int*)aligned_alloc(64, ((num_words * 64 * sizeof(int) + 63) / 64) * 64);
+    if (visited == NULL || key == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for %d nodes\n", n);
+        exit(EXIT_FAILURE);
     }
-}
+    MinPair best;
 
-void add_edge(int src, int dst, int weight) {
-    if (graph[src]->num_edges >= graph[src]->capacity) {
-        graph[src]->capacity *= 2;
-        graph[src]->edges = (Edge*)realloc(graph[src]->edges, graph[src]->capacity * sizeof(Edge));
-        if (graph[src]->edges == NULL) {
-            fprintf(stderr, "Error: Could not allocate memory for edges of node %d\n", src);
-            exit(EXIT_FAILURE);
+    #pragma omp parallel
+    {
+        #pragma omp for
+        for (long w = 0; w < num_words; w++) {
+            // Padding vertices past n start out visited so they are never picked.
+            visited[w] = (w == num_words - 1 && n % 64) ? ~0ULL << (n % 64) : 0;
+            for (int j = 0; j < 64; j++)
+                key[w * 64 + j] = INF;
         }
-    }
-    graph[src]->edges[graph[src]->num_edges].dst = dst;
-    graph[src]->edges[graph[src]->num_edges].weight = weight;
-    graph[src]->num_edges++;
-}
+        #pragma omp for
+        for (int i = 0; i < n; i++)
+            dist[i] = INF;
+        #pragma omp single
+        key[src] = 0;
 
-void dijkstra(int src, int dist[]) {
-    bool visited[MAX_NODES];
-    int i, u, v;
+        for (;;) {
+            #pragma omp single
+            {
+                best.dist = INF;
+                best.node = -1;
+            }
 
-    #pragma omp parallel for
-    for (i = 0; i < MAX_NODES; i++) {
-        dist[i] = INF;
-        visited[i] = false;
-    }
-    dist[src] = 0;
+            INSTR_BEGIN(PHASE_EXTRACT_MIN);
+            #pragma omp for schedule(static) reduction(minpair:best)
+            for (long w = 0; w < num_words; w++) {
+                uint64_t word = visited[w];
+                if (word == ~0ULL)
+                    continue;
+                const int* block = key + w * 64;
+                int m = INF;
+                #pragma omp simd reduction(min:m)
+                for (int j = 0; j < 64; j++)
+                    m = block[j] < m ? block[j] : m;
+                if (m < best.dist) {
+                    int j = 0;
+                    while (block[j] != m)
+                        j++;
+                    best.dist = m;
+                    best.node = (int)(w * 64 + j);
+                }
+            }
 
-    #pragma omp parallel
-    {
-        #pragma omp single nowait
-        {
-            for (int count = 0; count < MAX_NODES - 1; count++) {
-                int min_dist = INF;
+            INSTR_END(PHASE_EXTRACT_MIN);
+
+            // No reachable unvisited vertex is left.
+            if (best.node < 0)
+                break;
 
-                #pragma omp task shared(u, min_dist)
+            int u = best.node;
+            int du = best.dist;
+            uint64_t bit = 1ULL << (u % 64);
+            long begin = g->indexofNodes[u], end = g->indexofNodes[u + 1];
+
+            if (end - begin < PARALLEL_RELAX_DEGREE) {
+                #pragma omp single
                 {
-                    for (v = 0; v < MAX_NODES; v++) {
-                        if (!visited[v] && dist[v] < min_dist) {
-                            #pragma omp critical
-                            {
-                                if (!visited[v] && dist[v] < min_dist) {
-                                    min_dist = dist[v];
-                                    u = v;
-                                }
-                            }
+                    INSTR_BEGIN(PHASE_RELAX);
+                    INSTR_COUNT(COUNT_RELAXATIONS, end - begin);
+                    visited[u / 64] |= bit;
+                    key[u] = INF;
+                    dist[u] = du;
+                    for (long i = begin; i < end; i++) {
+                        int v = g->edgeList[i];
+                        int nd = du + g->edgeLen[i];
+                        if (nd < key[v] && !(visited[v / 64] & (1ULL << (v % 64)))) {
+                            key[v] = nd;
+                            INSTR_COUNT(COUNT_UPDATES, 1);
                         }
                     }
+                    INSTR_END(PHASE_RELAX);
                 }
-                #pragma omp taskwait
-
-                if (u == -1) break; // All reachable nodes have been visited
-
-                visited[u] = true;
-
-                #pragma omp parallel for shared(dist, visited) private(v)
-                for (i = 0; i < graph[u]->num_edges; i++) {
-                    v = graph[u]->edges[i].dst;
-                    int weight = graph[u]->edges[i].weight;
-                    if (!visited[v] && dist[u] != INF && dist[u] + weight < dist[v]) {
-                        #pragma omp critical
-                        {
-                            if (dist[u] + weight < dist[v]) {
-                                dist[v] = dist[u] + weight;
-                            }
-                        }
+            } else {
+                #pragma omp single
+                {
+                    visited[u / 64] |= bit;
+                    key[u] = INF;
+                    dist[u] = du;
+                    INSTR_COUNT(COUNT_RELAXATIONS, end - begin);
+                }
+
+                // Neighbour lists are sorted by (dst, weight), so only the
+                // first copy of a parallel edge can improve dist and no two
+                // threads ever write the same vertex.
+                INSTR_BEGIN(PHASE_RELAX);
+                #pragma omp for schedule(static)
+                for (long i = begin; i < end; i++) {
+                    int v = g->edgeList[i];
+                    if (i > begin && g->edgeList[i - 1] == v)
+                        continue;
+                    int nd = du + g->edgeLen[i];
+                    if (nd < key[v] && !(visited[v / 64] & (1ULL << (v % 64)))) {
+                        key[v] = nd;
+                        INSTR_COUNT(COUNT_UPDATES, 1);
                     }
                 }
+                INSTR_END(PHASE_RELAX);
             }
         }
     }
+
+    free(visited);
+    free(key);
 }
 
-int main(int argc, char* argv[]) {
-    initialize_graph();
+typedef struct {
+    const Graph* g;
+    int src;
+    int* dist;
+} DijkstraRun;
 
-    // Read edges from email-Enron.txt
-    FILE *file = fopen("/home/graphfiles/Email-Enron.txt", "r");
-    if (file == NULL) {
-        fprintf(stderr, "Error: Could not open file email-Enron.txt\n");
-        return 1;
-    }
+static void run_dijkstra(void* arg) {
+    DijkstraRun* r = (DijkstraRun*)arg;
+    dijkstra(r->g, r->src, r->dist);
+}
 
-    int src, dst;
-    while (fscanf(file, "%d\t%d", &src, &dst) != EOF) {
-        if (src >= MAX_NODES || dst >= MAX_NODES) {
-            fprintf(stderr, "Error: Node index out of bounds (src: %d, dst: %d)\n", src, dst);
-            continue; // Skip invalid edges
-        }
-        add_edge(src, dst, 1);
-        add_edge(dst, src, 1); // For undirected graph
-    }
-    fclose(file);
+typedef struct {
+    SsspSolver* solver;
+    int src;
+    int* dist;
+} SolveRun;
 
-    for (int num_threads = 16; num_threads >= 1; num_threads--) {
-        omp_set_num_threads(num_threads);
+static void run_solve(void* arg) {
+    SolveRun* r = (SolveRun*)arg;
+    sssp_solve(r->solver, r->src, r->dist);
+}
 
-        double start_time = omp_get_wtime();
+int main(int argc, char* argv[]) {
+    Graph g;
+    const char* path;
+    bool undirected;
+    BenchConfig cfg;
+
+    // e.g. /home/graphfiles/Email-Enron.txt --threads 16-1 --reps 10 --csv results.csv --reorder rcm
+    bench_parse_args(&argc, argv, &cfg);
+    parse_graph_args(argc, argv, &path, &undirected, true);
+    open_graph(&g, path, undirected);
 
-        int dist[MAX_NODES];
-        dijkstra(0, dist);
+    int* dist = (int*)graph_malloc(g.num_nodes * sizeof(int), "distances");
 
-        double elapsed_time = omp_get_wtime() - start_time;
-        printf("Total time for %d threads (in sec): %.2f\n", num_threads, elapsed_time);
+    // With --reorder everything below runs on the relabelled graph from
+    // the same source vertex (original id 0).
+    int* perm = NULL;
+    char input[512];
+    snprintf(input, sizeof(input), "%s", path);
+    if (cfg.reorder != NULL) {
+        int kind = parse_reorder(cfg.reorder);
+        int* before_dist = (int*)graph_malloc(g.num_nodes * sizeof(int), "distances");
+        double start_time = omp_get_wtime();
+        dijkstra(&g, 0, before_dist);
+        double before = omp_get_wtime() - start_time;
+        ReorderStats stats;
+        perm = reorder_graph(&g, kind, &stats);
+        start_time = omp_get_wtime();
+        dijkstra(&g, reorder_id(perm, 0), dist);
+        double after = omp_get_wtime() - start_time;
+        int mismatches = 0;
+        for (int v = 0; v < g.num_nodes; v++)
+            if (dist[reorder_id(perm, v)] != before_dist[v])
+                mismatches++;
+        if (kind != REORDER_NONE)
+            reorder_report(&stats, "dijkstra-tasks", before, after);
+        if (mismatches)
+            printf("  REORDERED DISTANCES DIFFER for %d vertices\n", mismatches);
+        snprintf(input, sizeof(input), "%s, %s order", path, reorder_name(kind));
+        free(before_dist);
     }
+    int src = reorder_id(perm, 0);
+
+    DijkstraRun run = { &g, src, dist };
+    bench_run(&cfg, "dijkstra-tasks", input, NULL, run_dijkstra, &run, g.num_edges / 1e9, "GTEPS");
 
-    // Free the graph memory
-    for (int i = 0; i < MAX_NODES; i++) {
-        free(graph[i]->edges);
-        free(graph[i]);
+    // The same query through the front end, which runs a direction-
+    // optimizing BFS when all weights are equal, as in unweighted inputs,
+    // and a bucket queue or radix heap for other non-negative weights.
+    Graph rev;
+    memset(&rev, 0, sizeof(rev));
+    if (!undirected)
+        transpose_graph(&g, &rev);
+    SsspSolver solver;
+    sssp_solver_init(&solver, &g, undirected ? &g : &rev);
+    int* solved = (int*)graph_malloc(g.num_nodes * sizeof(int), "distances");
+    SolveRun solve_run = { &solver, src, solved };
+    char solve_name[64];
+    snprintf(solve_name, sizeof(solve_name), "sssp-%s", sssp_kernel_name(solver.kernel));
+    bench_run(&cfg, solve_name, input, NULL, run_solve, &solve_run, g.num_edges / 1e9, "GTEPS");
+    int mismatches = 0;
+    for (int i = 0; i < g.num_nodes; i++)
+        if (solved[i] != dist[i])
+            mismatches++;
+    if (solver.kernel == SSSP_KERNEL_BFS)
+        printf("BFS: %d levels, %d bottom-up, %.2f edge checks per edge\n", solver.levels,
+               solver.bottom_up_levels, (double)solver.examined / (g.num_edges ? g.num_edges : 1));
+    if (solver.kernel == SSSP_KERNEL_DIAL || solver.kernel == SSSP_KERNEL_RADIX)
+        printf("%s: %ld buckets, %ld stale entries\n", sssp_kernel_name(solver.kernel), solver.buckets,
+               solver.stale);
+    if (mismatches)
+        printf("  FRONT END DISTANCES DIFFER for %d vertices\n", mismatches);
+    free(solved);
+    sssp_solver_free(&solver);
+    free_graph(&rev);
+
+    if (INSTR_ENABLED) {
+        instr_reset();
+        dijkstra(&g, src, dist);
+        instr_report("dijkstra-tasks");
     }
 
+    free(perm);
+    free(dist);
+    free_graph(&g);
+
     return 0;
 }
\ No newline at end of file
@@ -1,51 +1,306 @@
-#include <stdlib.h>   
-#include <stdio.h>    
-#include <omp.h>      
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <omp.h>
+#include <immintrin.h>
 
-#define ARRAY_SIZE 1000000     
-#define NUM_THREADS 12    
+#include "bench.h"
+#include "numa.h"
 
-int main (int argc, char *argv[]) {
-    // elements of arrays a and b will be added
-    // and placed in array c
-    int *a;
-    int *b; 
-    int *c;
-        
-    int n = ARRAY_SIZE;                 
-    int total_threads = NUM_THREADS;    
-    int i;       // loop index
+// STREAM-style memory bandwidth kernels. Each array should be several
+// times the last-level cache so every pass streams from DRAM; by default
+// arrays are sized to 4x the LLC, capped at MAX_DEFAULT_SIZE elements.
+// --numa picks how the arrays are placed (serial initialisation is the
+// unplaced baseline), and a triad per NUMA node, with the team pinned to
+// that node's CPUs and its arrays in local memory, gives the bandwidth of
+// each socket on its own.
+#define ARRAY_SIZE 1000000
+#define MAX_DEFAULT_SIZE (64L * 1024 * 1024)
+#define SCALAR 3.0
+
+// Vector helpers; every thread's range starts on a 64-byte boundary so the
+// aligned and streaming forms can be used throughout.
+#if defined(__AVX512F__)
+typedef __m512d vdouble;
+#define VLEN 8
+#define vload(p)      _mm512_load_pd(p)
+#define vstore(p, x)  _mm512_store_pd(p, x)
+#define vstream(p, x) _mm512_stream_pd(p, x)
+#define vset1(x)      _mm512_set1_pd(x)
+#define vadd(a, b)    _mm512_add_pd(a, b)
+#define vmul(a, b)    _mm512_mul_pd(a, b)
+#elif defined(__AVX__)
+typedef __m256d vdouble;
+#define VLEN 4
+#define vload(p)      _mm256_load_pd(p)
+#define vstore(p, x)  _mm256_store_pd(p, x)
+#define vstream(p, x) _mm256_stream_pd(p, x)
+#define vset1(x)      _mm256_set1_pd(x)
+#define vadd(a, b)    _mm256_add_pd(a, b)
+#define vmul(a, b)    _mm256_mul_pd(a, b)
+#else
+typedef __m128d vdouble;
+#define VLEN 2
+#define vload(p)      _mm_load_pd(p)
+#define vstore(p, x)  _mm_store_pd(p, x)
+#define vstream(p, x) _mm_stream_pd(p, x)
+#define vset1(x)      _mm_set1_pd(x)
+#define vadd(a, b)    _mm_add_pd(a, b)
+#define vmul(a, b)    _mm_mul_pd(a, b)
+#endif
+
+// Elements per 64-byte cache line.
+#define LINE 8
+
+enum { COPY, SCALE, ADD, TRIAD, AXPY, NUM_KERNELS };
+
+static const char* kernel_names[NUM_KERNELS] = { "copy", "scale", "add", "triad", "axpy" };
+// Bytes counted per element, as STREAM does: reads plus writes, without the
+// extra read a regular store causes through write-allocate.
+static const int kernel_bytes[NUM_KERNELS] = { 16, 16, 24, 24, 24 };
+
+// Static partition of [0, n) into whole cache lines, identical for the
+// first-touch initialisation and every kernel so each thread only ever
+// touches pages it placed.
+static void thread_range(long n, long* lo, long* hi) {
+    int tid = omp_get_thread_num();
+    int nt = omp_get_num_threads();
+    long lines = (n + LINE - 1) / LINE;
+    *lo = lines * tid / nt * LINE;
+    *hi = lines * (tid + 1) / nt * LINE;
+    if (*hi > n) *hi = n;
+    if (*lo > n) *lo = n;
+}
+
+// dst = x + s * y over one thread's range; x or y may be NULL for the
+// kernels that do not use them.
+static void kernel_range(double* dst, const double* x, const double* y, double s,
+                         long lo, long hi, int streaming) {
+    long i = lo;
+    long vhi = lo + (hi - lo) / VLEN * VLEN;
+    vdouble vs = vset1(s);
+
+    #define KERNEL_LOOP(expr)                              \
+        if (streaming)                                     \
+            for (; i < vhi; i += VLEN) vstream(dst + i, expr); \
+        else                                               \
+            for (; i < vhi; i += VLEN) vstore(dst + i, expr);
+
+    if (x && y) {
+        if (s == 1.0) {
+            KERNEL_LOOP(vadd(vload(x + i), vload(y + i)))
+        } else {
+            KERNEL_LOOP(vadd(vload(x + i), vmul(vs, vload(y + i))))
+        }
+    } else if (y) {
+        KERNEL_LOOP(vmul(vs, vload(y + i)))
+    } else {
+        KERNEL_LOOP(vload(x + i))
+    }
+    #undef KERNEL_LOOP
+
+    for (; i < hi; i++)
+        dst[i] = (x ? x[i] : 0.0) + (y ? s * y[i] : 0.0);
+}
+
+static void run_kernel(int kernel, double* a, double* b, double* c, long n, int streaming) {
+    #pragma omp parallel
+    {
+        long lo, hi;
+        thread_range(n, &lo, &hi);
+        switch (kernel) {
+        case COPY:  kernel_range(c, a, NULL, 1.0, lo, hi, streaming); break;
+        case SCALE: kernel_range(b, NULL, c, SCALAR, lo, hi, streaming); break;
+        case ADD:   kernel_range(c, a, b, 1.0, lo, hi, streaming); break;
+        case TRIAD: kernel_range(a, b, c, SCALAR, lo, hi, streaming); break;
+        case AXPY:  kernel_range(b, b, a, SCALAR, lo, hi, streaming); break;
+        }
+        if (streaming)
+            _mm_sfence();
+    }
+}
+
+// Fresh arrays placed under policy: serial has the master thread write
+// them all, otherwise each thread first touches the range it will stream.
+static void alloc_arrays(double** a, double** b, double** c, long n, int policy) {
+    *a = (double*)numa_alloc(n * sizeof(double), policy, "array a");
+    *b = (double*)numa_alloc(n * sizeof(double), policy, "array b");
+    *c = (double*)numa_alloc(n * sizeof(double), policy, "array c");
+    double* x = *a;
+    double* y = *b;
+    double* z = *c;
+    if (policy == NUMA_SERIAL) {
+        for (long i = 0; i < n; i++) {
+            x[i] = 1.0;
+            y[i] = 2.0;
+            z[i] = 0.0;
+        }
+        return;
+    }
+    #pragma omp parallel
+    {
+        long lo, hi;
+        thread_range(n, &lo, &hi);
+        for (long i = lo; i < hi; i++) {
+            x[i] = 1.0;
+            y[i] = 2.0;
+            z[i] = 0.0;
+        }
+    }
+}
+
+// Replays the kernels on scalars, each run `runs` times in kernel order as
+// the benchmark does, and checks every element against them.
+static long check_results(const double* a, const double* b, const double* c, long n, int runs) {
+    double aj = 1.0, bj = 2.0, cj = 0.0;
+    for (int k = 0; k < runs; k++) cj = aj;
+    for (int k = 0; k < runs; k++) bj = SCALAR * cj;
+    for (int k = 0; k < runs; k++) cj = aj + bj;
+    for (int k = 0; k < runs; k++) aj = bj + SCALAR * cj;
+    for (int k = 0; k < runs; k++) bj = bj + SCALAR * aj;
+    long errors = 0;
+    #pragma omp parallel for schedule(static) reduction(+:errors)
+    for (long i = 0; i < n; i++)
+        if (fabs(a[i] - aj) > 1e-13 * fabs(aj) || fabs(b[i] - bj) > 1e-13 * fabs(bj) ||
+            fabs(c[i] - cj) > 1e-13 * fabs(cj))
+            errors++;
+    return errors;
+}
+
+typedef struct {
+    int kernel;
+    int streaming;
+    double* a;
+    double* b;
+    double* c;
+    long n;
+} StreamRun;
+
+static void run_stream(void* arg) {
+    StreamRun* r = (StreamRun*)arg;
+    run_kernel(r->kernel, r->a, r->b, r->c, r->n, r->streaming);
+}
+
+static long parse_size(const char* s) {
+    char* end;
+    long n = strtol(s, &end, 10);
+    if (*end == 'K' || *end == 'k') n <<= 10;
+    if (*end == 'M' || *end == 'm') n <<= 20;
+    if (*end == 'G' || *end == 'g') n <<= 30;
+    return n;
+}
 
-    double start_time, end_time; 
+// Triad with the team pinned to each NUMA node in turn and the arrays
+// first touched there: local bandwidth per socket, in each streaming form
+// that mode selects. Pinning replaces the --bind placement, so this runs
+// last, and only with two or more nodes: on one it would repeat the
+// full-machine triad.
+static void node_bandwidth(const BenchConfig* cfg, long n, const char* mode) {
+    if (numa_num_nodes() < 2)
+        return;
+    for (int node = 0; node < numa_num_nodes(); node++) {
+        unsigned long mask[NUMA_MAX_CPUS / (8 * sizeof(long))];
+        int cpus = numa_node_cpus(node, mask);
+        if (cpus == 0)
+            continue;
+        omp_set_num_threads(cpus);
+        int bound = 1;
+        #pragma omp parallel reduction(&&:bound)
+        bound = numa_bind_node(node) == 0;
+        if (!bound)
+            printf("Warning: Could not pin threads to node %d\n", node);
 
-    a = (int *) malloc(sizeof(int) * n);
-    b = (int *) malloc(sizeof(int) * n);
-    c = (int *) malloc(sizeof(int) * n);
+        for (int streaming = 0; streaming <= 1; streaming++) {
+            if ((streaming && strcmp(mode, "regular") == 0) || (!streaming && strcmp(mode, "nontemporal") == 0))
+                continue;
+            double *a, *b, *c;
+            alloc_arrays(&a, &b, &c, n, NUMA_FIRST_TOUCH);
+            StreamRun run = { TRIAD, streaming, a, b, c, n };
+            BenchStats stats;
+            bench_measure(cfg, NULL, run_stream, &run, &stats);
 
-    for(i = 0; i < n; i++) {
-        a[i] = i;
+            char name[64], input[64];
+            snprintf(name, sizeof(name), "stream-triad%s-node%d", streaming ? "-nt" : "", node);
+            snprintf(input, sizeof(input), "%ld elements, %d cpus", n, cpus);
+            bench_report(cfg, name, input, &stats, 1, (double)kernel_bytes[TRIAD] * n / 1e9, "GB/s");
+            free(a);
+            free(b);
+            free(c);
+        }
     }
-    for(i = 0; i < n; i++) {
-        b[i] = i;
-    }   
+}
 
-    omp_set_num_threads(total_threads);
+// VECTORADDITION [elements, K/M/G suffix allowed] [regular|nontemporal|both] --threads 1-16 --numa serial --bind spread --csv results.csv
+int main (int argc, char *argv[]) {
+    BenchConfig cfg;
+    bench_parse_args(&argc, argv, &cfg);
+    int policy = parse_numa_policy(cfg.numa);
+    long llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    long n = llc > 0 ? 4 * llc / (long)sizeof(double) : ARRAY_SIZE;
+    if (n > MAX_DEFAULT_SIZE) n = MAX_DEFAULT_SIZE;
+    if (n < ARRAY_SIZE) n = ARRAY_SIZE;
+    if (argc > 1) n = parse_size(argv[1]);
+    const char* mode = argc > 2 ? argv[2] : "both";
+    if (n <= 0) {
+        fprintf(stderr, "Error: Array size must be positive\n");
+        return 1;
+    }
 
-    start_time = omp_get_wtime();
+    printf("Array size: %ld elements, %.1f MB per array, %.1f MB total (LLC %.1f MB)\n",
+           n, n * 8.0 / 1e6, 3 * n * 8.0 / 1e6, llc / 1e6);
+    printf("NUMA nodes: %d, placement: %s\n", numa_num_nodes(), numa_policy_name(policy));
 
-    #pragma omp parallel for shared(a, b, c) private(i) schedule(dynamic)
-    for(i = 0; i < n; i++) {
-        c[i] = a[i] + b[i];
+    // stats[streaming][kernel][thread count]
+    int counts = cfg.num_thread_counts;
+    BenchStats* stats = (BenchStats*)malloc(2 * NUM_KERNELS * counts * sizeof(BenchStats));
+    if (stats == NULL) {
+        fprintf(stderr, "Error: Could not allocate benchmark results\n");
+        return 1;
     }
 
-    end_time = omp_get_wtime(); 
+    for (int t = 0; t < counts; t++) {
+        omp_set_num_threads(cfg.threads[t]);
+
+        for (int streaming = 0; streaming <= 1; streaming++) {
+            if ((streaming && strcmp(mode, "regular") == 0) || (!streaming && strcmp(mode, "nontemporal") == 0))
+                continue;
+
+            double *a, *b, *c;
+            alloc_arrays(&a, &b, &c, n, policy);
+
+            for (int kernel = 0; kernel < NUM_KERNELS; kernel++) {
+                StreamRun run = { kernel, streaming, a, b, c, n };
+                bench_measure(&cfg, NULL, run_stream, &run,
+                              &stats[(streaming * NUM_KERNELS + kernel) * counts + t]);
+            }
+
+            long errors = check_results(a, b, c, n, cfg.warmup + cfg.reps);
+            if (errors)
+                printf("Validation failed at %d threads: %ld elements differ\n", cfg.threads[t], errors);
+
+            free(a);
+            free(b);
+            free(c);
+        }
+    }
+
+    char input[64];
+    snprintf(input, sizeof(input), "%ld elements, %s", n, numa_policy_name(policy));
+    for (int streaming = 0; streaming <= 1; streaming++) {
+        if ((streaming && strcmp(mode, "regular") == 0) || (!streaming && strcmp(mode, "nontemporal") == 0))
+            continue;
+        for (int kernel = 0; kernel < NUM_KERNELS; kernel++) {
+            char name[64];
+            snprintf(name, sizeof(name), "stream-%s%s", kernel_names[kernel], streaming ? "-nt" : "");
+            bench_report(&cfg, name, input, &stats[(streaming * NUM_KERNELS + kernel) * counts],
+                         counts, (double)kernel_bytes[kernel] * n / 1e9, "GB/s");
+        }
+    }
 
-    printf("Time taken: %f seconds\n", end_time - start_time); 
-	
+    free(stats);
 
-    free(a);  
-    free(b); 
-    free(c);
-	
+    node_bandwidth(&cfg, n, mode);
     return 0;
 }
@@ -0,0 +1,102 @@
+#ifndef ATOMIC_UTIL_H
+#define ATOMIC_UTIL_H
+
+#include <stdbool.h>
+
+// Lock-free helpers for concurrent relaxations, built on the GCC/Clang
+// __atomic builtins so they work from both the C and the C++ programs.
+//
+// Ordering: a relaxing thread lowers dist[v] and then tests v's flag; the
+// owner of the frontier clears u's flag and then reads dist[u]. Either the
+// relaxer sees the flag clear and queues the vertex again, or the owner
+// must see the new distance. Both flag operations are read-modify-writes on
+// the same byte, so a releasing update after the distance CAS and an
+// acquiring clear before the distance load give that guarantee; with
+// relaxed ordering the owner's load could be satisfied before its clear and
+// the improvement be lost. Hence the release/acquire orders below.
+
+// Lowers *target to value if value is smaller. Returns true if this call
+// performed the update.
+static inline bool atomicMin(int* target, int value) {
+    int old = __atomic_load_n(target, __ATOMIC_RELAXED);
+    while (value < old) {
+        if (__atomic_compare_exchange_n(target, &old, value, true,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            return true;
+    }
+    return false;
+}
+
+// Frontier membership flags, one byte per vertex. testAndSetFlag returns
+// true only for the call that raised the flag, so among concurrent
+// relaxations that improve the same vertex exactly one queues it; the
+// owner of the frontier clears the flag when the vertex is taken off,
+// before reading its distance (see the ordering note above).
+static inline bool testAndSetFlag(unsigned char* flag) {
+    return !__atomic_exchange_n(flag, 1, __ATOMIC_ACQ_REL);
+}
+
+static inline void clearFlag(unsigned char* flag) {
+    __atomic_exchange_n(flag, 0, __ATOMIC_SEQ_CST);
+}
+
+// The same on a bitmap of 64-bit words, for frontiers kept as bits.
+static inline bool testAndSetBit(unsigned long long* bits, long i) {
+    unsigned long long mask = 1ULL << (i & 63);
+    return !(__atomic_fetch_or(&bits[i >> 6], mask, __ATOMIC_ACQ_REL) & mask);
+}
+
+#ifdef __cplusplus
+// atomicMin for the other distance types of dist_types.h (uint8_t, uint16_t,
+// int64_t, float), through the generic builtins so float works as well.
+template <typename T> static inline bool atomicMin(T* target, T value) {
+    T old;
+    __atomic_load(target, &old, __ATOMIC_RELAXED);
+    while (value < old) {
+        if (__atomic_compare_exchange(target, &old, &value, true,
+                                      __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            return true;
+    }
+    return false;
+}
+
+// Relaxed load of a distance that other threads may be lowering with
+// atomicMin, so the read is neither torn nor a data race.
+template <typename T> static inline T atomicLoad(const T* target) {
+    T value;
+    __atomic_load(target, &value, __ATOMIC_RELAXED);
+    return value;
+}
+#endif
+
+// A distance and the vertex it was reached from, packed into one word so
+// both change together. Distances are non-negative, so packed words order
+// by distance first; a parent of -1 means none.
+static inline unsigned long long packDistParent(int dist, int parent) {
+    return ((unsigned long long)(unsigned)dist << 32) | (unsigned)parent;
+}
+
+static inline int packedDist(unsigned long long packed) {
+    return (int)(packed >> 32);
+}
+
+static inline int packedParent(unsigned long long packed) {
+    return (int)(unsigned)packed;
+}
+
+// Lowers the distance in *target to dist with parent as its predecessor if
+// dist is strictly smaller; ties keep the existing parent, so parents never
+// form cycles through equal distances. Returns true if this call performed
+// the update.
+static inline bool atomicMinDistParent(unsigned long long* target, int dist, int parent) {
+    unsigned long long value = packDistParent(dist, parent);
+    unsigned long long old = __atomic_load_n(target, __ATOMIC_RELAXED);
+    while (dist < packedDist(old)) {
+        if (__atomic_compare_exchange_n(target, &old, value, true,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            return true;
+    }
+    return false;
+}
+
+#endif
@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <omp.h>
+
+#include "bench.h"
+#include "atomicUtil.h"
+
+// Contention microbenchmark for the relaxation primitives of atomicUtil.h,
+// against the omp critical section the relax loops used to take. A fixed
+// number of operations is split over the threads of each run, so the rate
+// reported is total throughput: flat or rising means the primitive scales,
+// falling means threads queue on the cache lines they share.
+//   hot     every thread lowers the same word (a hub vertex everyone
+//           relaxes); values interleave across threads and decrease, so
+//           most CAS attempts race and many lose
+//   spread  random words of a table well beyond the last-level cache
+//           (relaxations spread over a large graph)
+#define DEFAULT_OPS (1L << 24)
+#define TABLE_SIZE (1L << 22)
+
+enum { MIN_HOT, MIN_SPREAD, PARENT_HOT, PARENT_SPREAD, FLAG_SPREAD, CRITICAL_HOT, NUM_TESTS };
+
+static const char* test_names[NUM_TESTS] = {
+    "atomic-min-hot", "atomic-min-spread", "atomic-min-parent-hot", "atomic-min-parent-spread",
+    "test-and-set-spread", "critical-min-hot"
+};
+
+typedef struct {
+    int test;
+    long ops;
+    int* words;
+    unsigned long long* packed;
+    unsigned char* flags;
+    long wins;
+} ContentionRun;
+
+static inline unsigned long long mix(unsigned long long z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static void reset_table(void* arg) {
+    ContentionRun* r = (ContentionRun*)arg;
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < TABLE_SIZE; i++) {
+        r->words[i] = INT_MAX;
+        r->packed[i] = packDistParent(INT_MAX, -1);
+        r->flags[i] = 0;
+    }
+}
+
+static void run_contention(void* arg) {
+    ContentionRun* r = (ContentionRun*)arg;
+    long wins = 0;
+    #pragma omp parallel reduction(+:wins)
+    {
+        int tid = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        long lo = r->ops * tid / nt, hi = r->ops * (tid + 1) / nt;
+        for (long i = lo; i < hi; i++) {
+            unsigned long long z = mix((unsigned long long)i * 0x9e3779b97f4a7c15ULL + 1);
+            long slot = (long)(z % TABLE_SIZE);
+            // Hot values: thread tid's k-th operation offers INT_MAX - 1 - (k * nt + tid)
+            int hot = INT_MAX - 1 - (int)(((i - lo) * nt + tid) % (INT_MAX - 1));
+            int value = (int)((z >> 32) % INT_MAX);
+            switch (r->test) {
+            case MIN_HOT:       wins += atomicMin(&r->words[0], hot); break;
+            case MIN_SPREAD:    wins += atomicMin(&r->words[slot], value); break;
+            case PARENT_HOT:    wins += atomicMinDistParent(&r->packed[0], hot, tid); break;
+            case PARENT_SPREAD: wins += atomicMinDistParent(&r->packed[slot], value, tid); break;
+            case FLAG_SPREAD:   wins += testAndSetFlag(&r->flags[slot]); break;
+            default:
+                #pragma omp critical
+                if (hot < r->words[0]) {
+                    r->words[0] = hot;
+                    wins++;
+                }
+            }
+        }
+    }
+    r->wins = wins;
+}
+
+// atomiccontention [operations] --threads 1,2,4,8,16,32,64 --reps 5 --csv results.csv
+int main(int argc, char* argv[]) {
+    BenchConfig cfg;
+    bench_parse_args(&argc, argv, &cfg);
+    long ops = argc > 1 ? atol(argv[1]) : DEFAULT_OPS;
+    if (ops <= 0) {
+        fprintf(stderr, "Error: Number of operations must be positive\n");
+        return 1;
+    }
+
+    ContentionRun run;
+    run.ops = ops;
+    run.words = (int*)malloc(TABLE_SIZE * sizeof(int));
+    run.packed = (unsigned long long*)malloc(TABLE_SIZE * sizeof(unsigned long long));
+    run.flags = (unsigned char*)malloc(TABLE_SIZE);
+    if (run.words == NULL || run.packed == NULL || run.flags == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for %ld-entry tables\n", TABLE_SIZE);
+        return 1;
+    }
+
+    char input[64];
+    snprintf(input, sizeof(input), "%ld ops, %ld-entry table", ops, TABLE_SIZE);
+    for (int test = 0; test < NUM_TESTS; test++) {
+        run.test = test;
+        bench_run(&cfg, test_names[test], input, reset_table, run_contention, &run, ops / 1e6, "Mops/s");
+        // Share of operations that changed the word or raised the flag, at
+        // the last thread count measured.
+        printf("  %.1f%% of operations won\n", 100.0 * run.wins / ops);
+    }
+
+    free(run.words);
+    free(run.packed);
+    free(run.flags);
+    return 0;
+}
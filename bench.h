@@ -0,0 +1,328 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <omp.h>
+
+// Shared benchmark harness. Every program accepts the same options, which
+// are removed from argv before the program reads its positional arguments:
+//   --threads LIST   thread counts, e.g. 1,2,4,8 or 16-1 (default 1, 2, 4,
+//                    ... up to the number of processors)
+//   --warmup N       untimed runs before measuring each thread count (1)
+//   --reps N         timed runs per thread count (5)
+//   --csv PATH       append one row per thread count, header if new file
+//   --json PATH      append one JSON object per thread count (JSON lines)
+//   --reorder NAME   relabel graph inputs first: none, degree, hub, rcm or
+//                    gorder (see graph_reorder.h); used by the SSSP
+//                    programs, ignored by the others (floydonlarge warns)
+//   --bind MODE      pin OpenMP threads: close (fill one socket first),
+//                    spread (round-robin over sockets) or none (default);
+//                    sets OMP_PROC_BIND, and OMP_PLACES=cores unless given,
+//                    then restarts the program so the runtime reads them
+//   --numa POLICY    placement of large arrays: serial, first-touch
+//                    (default), interleave or replicate (see numa.h);
+//                    ignored by programs that do not place memory
+// Results are tagged with kernel, input, host and time so files from
+// different commits and machines can be concatenated and diffed.
+
+#define BENCH_MAX_THREAD_COUNTS 256
+#define BENCH_MAX_REPS 1000
+
+typedef struct {
+    int threads[BENCH_MAX_THREAD_COUNTS];
+    int num_thread_counts;
+    int warmup;
+    int reps;
+    const char* csv_path;
+    const char* json_path;
+    const char* reorder;
+    const char* bind;
+    const char* numa;
+} BenchConfig;
+
+// Timings of one kernel at one thread count.
+typedef struct {
+    int threads;
+    int reps;
+    double median, min, mean, stddev;
+    double times[BENCH_MAX_REPS];
+} BenchStats;
+
+static inline void bench_add_threads(BenchConfig* cfg, int threads) {
+    if (cfg->num_thread_counts == BENCH_MAX_THREAD_COUNTS) {
+        fprintf(stderr, "Error: More than %d thread counts\n", BENCH_MAX_THREAD_COUNTS);
+        exit(EXIT_FAILURE);
+    }
+    cfg->threads[cfg->num_thread_counts++] = threads;
+}
+
+// Parses "1,2,4" / "16-1" / "1-4,8,16" into cfg->threads.
+static inline void bench_parse_threads(BenchConfig* cfg, const char* spec) {
+    const char* p = spec;
+    cfg->num_thread_counts = 0;
+    while (*p) {
+        char* end;
+        long lo = strtol(p, &end, 10), hi = lo;
+        if (end != p && *end == '-') {
+            p = end + 1;
+            hi = strtol(p, &end, 10);
+        }
+        if (end == p || lo <= 0 || hi <= 0 || (*end && *end != ',')) {
+            fprintf(stderr, "Error: Bad thread list %s (expected e.g. 1,2,4 or 16-1)\n", spec);
+            exit(EXIT_FAILURE);
+        }
+        for (long t = lo; lo <= hi ? t <= hi : t >= hi; t += lo <= hi ? 1 : -1)
+            bench_add_threads(cfg, (int)t);
+        p = *end ? end + 1 : end;
+    }
+}
+
+// OpenMP reads OMP_PROC_BIND and OMP_PLACES once, when the runtime starts,
+// so --bind cannot take effect in the running process: the variables are
+// set and the program re-executes itself with the same arguments. Runs
+// before anything touches OpenMP. The restarted process finds them set and
+// carries on; if the restart fails the run continues unbound.
+static inline void bench_bind_threads(int argc, char* argv[]) {
+    const char* mode = NULL;
+    for (int i = 1; i + 1 < argc; i++)
+        if (strcmp(argv[i], "--bind") == 0)
+            mode = argv[i + 1];
+    if (mode == NULL || strcmp(mode, "none") == 0)
+        return;
+    if (strcmp(mode, "close") != 0 && strcmp(mode, "spread") != 0) {
+        fprintf(stderr, "Error: Unknown binding %s (expected close, spread or none)\n", mode);
+        exit(EXIT_FAILURE);
+    }
+    const char* current = getenv("OMP_PROC_BIND");
+    if (current && strcmp(current, mode) == 0 && getenv("OMP_PLACES"))
+        return;
+    setenv("OMP_PROC_BIND", mode, 1);
+    setenv("OMP_PLACES", "cores", 0);
+    fflush(stdout);
+    execv("/proc/self/exe", argv);
+    perror("Warning: Could not restart with thread binding");
+}
+
+// Fills in the defaults, then consumes the options above from argv and
+// shifts the remaining arguments down.
+static inline void bench_parse_args(int* argc, char* argv[], BenchConfig* cfg) {
+    bench_bind_threads(*argc, argv);
+    cfg->num_thread_counts = 0;
+    int procs = omp_get_num_procs();
+    for (int t = 1; t < procs; t *= 2)
+        bench_add_threads(cfg, t);
+    bench_add_threads(cfg, procs);
+    cfg->warmup = 1;
+    cfg->reps = 5;
+    cfg->csv_path = NULL;
+    cfg->json_path = NULL;
+    cfg->reorder = NULL;
+    cfg->bind = NULL;
+    cfg->numa = NULL;
+
+    int out = 1;
+    for (int i = 1; i < *argc; i++) {
+        const char* opt = argv[i];
+        if (strncmp(opt, "--", 2) != 0) {
+            argv[out++] = argv[i];
+            continue;
+        }
+        if (i + 1 >= *argc) {
+            fprintf(stderr, "Error: Option %s needs a value\n", opt);
+            exit(EXIT_FAILURE);
+        }
+        const char* value = argv[++i];
+        if (strcmp(opt, "--threads") == 0) {
+            bench_parse_threads(cfg, value);
+        } else if (strcmp(opt, "--warmup") == 0) {
+            cfg->warmup = atoi(value);
+        } else if (strcmp(opt, "--reps") == 0) {
+            cfg->reps = atoi(value);
+        } else if (strcmp(opt, "--csv") == 0) {
+            cfg->csv_path = value;
+        } else if (strcmp(opt, "--json") == 0) {
+            cfg->json_path = value;
+        } else if (strcmp(opt, "--reorder") == 0) {
+            cfg->reorder = value;
+        } else if (strcmp(opt, "--bind") == 0) {
+            cfg->bind = value;
+        } else if (strcmp(opt, "--numa") == 0) {
+            cfg->numa = value;
+        } else {
+            fprintf(stderr, "Error: Unknown option %s (expected --threads, --warmup, --reps, --csv, --json, --reorder, --bind or --numa)\n", opt);
+            exit(EXIT_FAILURE);
+        }
+    }
+    argv[out] = NULL;
+    *argc = out;
+
+    if (cfg->warmup < 0 || cfg->reps < 1 || cfg->reps > BENCH_MAX_REPS) {
+        fprintf(stderr, "Error: Need --warmup >= 0 and 1 <= --reps <= %d\n", BENCH_MAX_REPS);
+        exit(EXIT_FAILURE);
+    }
+    if (cfg->bind && strcmp(cfg->bind, "none") != 0)
+        printf("Threads bound: OMP_PROC_BIND=%s, OMP_PLACES=%s\n", getenv("OMP_PROC_BIND"), getenv("OMP_PLACES"));
+}
+
+static inline int bench_compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Runs `run` cfg->warmup + cfg->reps times with the current number of
+// OpenMP threads; `setup` (may be NULL) runs untimed before each run to
+// reset the kernel's state.
+static inline void bench_measure(const BenchConfig* cfg, void (*setup)(void*),
+                                 void (*run)(void*), void* arg, BenchStats* stats) {
+    stats->threads = omp_get_max_threads();
+    stats->reps = cfg->reps;
+    for (int r = 0; r < cfg->warmup + cfg->reps; r++) {
+        if (setup)
+            setup(arg);
+        double start_time = omp_get_wtime();
+        run(arg);
+        double elapsed_time = omp_get_wtime() - start_time;
+        if (r >= cfg->warmup)
+            stats->times[r - cfg->warmup] = elapsed_time;
+    }
+
+    double sorted[BENCH_MAX_REPS];
+    int n = cfg->reps;
+    memcpy(sorted, stats->times, n * sizeof(double));
+    qsort(sorted, n, sizeof(double), bench_compare_double);
+    stats->min = sorted[0];
+    stats->median = n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+    double sum = 0, sq = 0;
+    for (int i = 0; i < n; i++)
+        sum += sorted[i];
+    stats->mean = sum / n;
+    for (int i = 0; i < n; i++)
+        sq += (sorted[i] - stats->mean) * (sorted[i] - stats->mean);
+    stats->stddev = n > 1 ? sqrt(sq / (n - 1)) : 0;
+}
+
+static inline void bench_json_string(FILE* f, const char* s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            fprintf(f, "\\%c", *s);
+        else if ((unsigned char)*s < 0x20)
+            fprintf(f, "\\u%04x", *s);
+        else
+            fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+// Prints the speedup/efficiency table for one kernel and appends the rows
+// to the CSV/JSON files. Speedup is relative to the smallest thread count
+// measured. When work > 0 a rate of work / median is added, in `unit`;
+// scale work to match (e.g. bytes / 1e9 for "GB/s").
+static inline void bench_report(const BenchConfig* cfg, const char* kernel, const char* input,
+                                const BenchStats* stats, int count, double work, const char* unit) {
+    if (count == 0)
+        return;
+    const BenchStats* base = &stats[0];
+    for (int i = 1; i < count; i++)
+        if (stats[i].threads < base->threads)
+            base = &stats[i];
+
+    char host[256] = "unknown";
+    gethostname(host, sizeof(host) - 1);
+    char stamp[32];
+    time_t now = time(NULL);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+    printf("%s (%s), %d warmup + %d reps\n", kernel, input, cfg->warmup, cfg->reps);
+    printf("%8s %12s %12s %12s %9s %11s", "Threads", "Median (s)", "Min (s)", "Stddev (s)",
+           "Speedup", "Efficiency");
+    if (work > 0)
+        printf(" %10s", unit);
+    printf("\n");
+
+    FILE* csv = NULL;
+    FILE* json = NULL;
+    if (cfg->csv_path) {
+        csv = fopen(cfg->csv_path, "a");
+        if (csv == NULL) {
+            fprintf(stderr, "Error: Could not open file %s\n", cfg->csv_path);
+            exit(EXIT_FAILURE);
+        }
+        fseek(csv, 0, SEEK_END);
+        if (ftell(csv) == 0)
+            fprintf(csv, "kernel,input,host,timestamp,threads,warmup,reps,median_sec,min_sec,"
+                         "mean_sec,stddev_sec,speedup,efficiency,rate,rate_unit\n");
+    }
+    if (cfg->json_path) {
+        json = fopen(cfg->json_path, "a");
+        if (json == NULL) {
+            fprintf(stderr, "Error: Could not open file %s\n", cfg->json_path);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        const BenchStats* s = &stats[i];
+        double speedup = base->median / s->median;
+        double efficiency = speedup * base->threads / s->threads;
+        double rate = work > 0 ? work / s->median : 0;
+        printf("%8d %12.6f %12.6f %12.6f %8.2fx %10.1f%%", s->threads, s->median, s->min,
+               s->stddev, speedup, 100 * efficiency);
+        if (work > 0)
+            printf(" %10.3f", rate);
+        printf("\n");
+
+        if (csv)
+            fprintf(csv, "%s,\"%s\",%s,%s,%d,%d,%d,%.9f,%.9f,%.9f,%.9f,%.4f,%.4f,%.6g,%s\n",
+                    kernel, input, host, stamp, s->threads, cfg->warmup, s->reps, s->median,
+                    s->min, s->mean, s->stddev, speedup, efficiency, rate, work > 0 ? unit : "");
+        if (json) {
+            fprintf(json, "{\"kernel\":");
+            bench_json_string(json, kernel);
+            fprintf(json, ",\"input\":");
+            bench_json_string(json, input);
+            fprintf(json, ",\"host\":");
+            bench_json_string(json, host);
+            fprintf(json, ",\"timestamp\":\"%s\",\"threads\":%d,\"warmup\":%d,\"reps\":%d,"
+                          "\"median_sec\":%.9f,\"min_sec\":%.9f,\"mean_sec\":%.9f,\"stddev_sec\":%.9f,"
+                          "\"speedup\":%.4f,\"efficiency\":%.4f",
+                    stamp, s->threads, cfg->warmup, s->reps, s->median, s->min, s->mean,
+                    s->stddev, speedup, efficiency);
+            if (work > 0)
+                fprintf(json, ",\"rate\":%.6g,\"rate_unit\":\"%s\"", rate, unit);
+            fprintf(json, ",\"times_sec\":[");
+            for (int r = 0; r < s->reps; r++)
+                fprintf(json, "%s%.9f", r ? "," : "", s->times[r]);
+            fprintf(json, "]}\n");
+        }
+    }
+
+    if (csv)
+        fclose(csv);
+    if (json)
+        fclose(json);
+}
+
+// Measures one kernel at every configured thread count and reports it.
+static inline void bench_run(const BenchConfig* cfg, const char* kernel, const char* input,
+                             void (*setup)(void*), void (*run)(void*), void* arg,
+                             double work, const char* unit) {
+    BenchStats* stats = (BenchStats*)malloc(cfg->num_thread_counts * sizeof(BenchStats));
+    if (stats == NULL) {
+        fprintf(stderr, "Error: Could not allocate benchmark results\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < cfg->num_thread_counts; i++) {
+        omp_set_num_threads(cfg->threads[i]);
+        bench_measure(cfg, setup, run, arg, &stats[i]);
+    }
+    bench_report(cfg, kernel, input, stats, cfg->num_thread_counts, work, unit);
+    free(stats);
+}
+
+#endif
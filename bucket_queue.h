@@ -0,0 +1,178 @@
+#ifndef BUCKET_QUEUE_H
+#define BUCKET_QUEUE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Monotone integer priority queues for Dijkstra on non-negative integer
+// weights: the keys pushed are never below the last key popped, which
+// lets both queues drop comparisons altogether. Both pop whole buckets,
+// every vertex queued at the current minimum key at once, so the caller
+// can relax them in parallel. Entries are never removed when a vertex's key
+// drops; the caller skips those whose key no longer matches its distance.
+//
+//   DialQueue   max_weight + 1 circular buckets, one per key in
+//               [min, min + max_weight]; push and pop are O(1) plus the
+//               scan over empty buckets, so meant for small max weights.
+//   RadixHeap   33 buckets by the highest bit in which a key differs from
+//               the last minimum; each entry moves down at most 32 times,
+//               whatever the weights.
+
+typedef struct {
+    int* items;
+    long size;
+    long capacity;
+} IntList;
+
+static inline void int_list_push(IntList* l, int x) {
+    if (l->size == l->capacity) {
+        l->capacity = l->capacity ? 2 * l->capacity : 64;
+        l->items = (int*)realloc(l->items, l->capacity * sizeof(int));
+        if (l->items == NULL) {
+            fprintf(stderr, "Error: Could not grow bucket to %ld entries\n", l->capacity);
+            exit(EXIT_FAILURE);
+        }
+    }
+    l->items[l->size++] = x;
+}
+
+typedef struct {
+    IntList* buckets;
+    int num_buckets;
+    long current;   // the smallest key that may still be queued
+    long size;
+} DialQueue;
+
+static inline void dial_init(DialQueue* q, int max_weight) {
+    q->num_buckets = max_weight + 1;
+    q->buckets = (IntList*)calloc(q->num_buckets, sizeof(IntList));
+    if (q->buckets == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for %d buckets\n", q->num_buckets);
+        exit(EXIT_FAILURE);
+    }
+    q->current = 0;
+    q->size = 0;
+}
+
+static inline void dial_free(DialQueue* q) {
+    for (int i = 0; i < q->num_buckets; i++)
+        free(q->buckets[i].items);
+    free(q->buckets);
+    q->buckets = NULL;
+}
+
+static inline void dial_clear(DialQueue* q) {
+    for (int i = 0; i < q->num_buckets; i++)
+        q->buckets[i].size = 0;
+    q->current = 0;
+    q->size = 0;
+}
+
+// key must lie in [current, current + max_weight].
+static inline void dial_push(DialQueue* q, int v, long key) {
+    int_list_push(&q->buckets[key % q->num_buckets], v);
+    q->size++;
+}
+
+// Moves the vertices of the lowest non-empty bucket to out and returns
+// how many there were (0 once the queue is empty), their key in *key.
+static inline long dial_pop_bucket(DialQueue* q, int* out, long* key) {
+    if (q->size == 0)
+        return 0;
+    IntList* b;
+    while ((b = &q->buckets[q->current % q->num_buckets])->size == 0)
+        q->current++;
+    long count = b->size;
+    memcpy(out, b->items, count * sizeof(int));
+    b->size = 0;
+    q->size -= count;
+    *key = q->current;
+    return count;
+}
+
+#define RADIX_BUCKETS 33
+
+typedef struct {
+    unsigned long long* items;   // key << 32 | vertex
+    long size;
+    long capacity;
+} RadixBucket;
+
+typedef struct {
+    RadixBucket buckets[RADIX_BUCKETS];
+    unsigned last;   // the last minimum popped
+    long size;
+} RadixHeap;
+
+static inline void radix_init(RadixHeap* h) {
+    memset(h, 0, sizeof(*h));
+}
+
+static inline void radix_free(RadixHeap* h) {
+    for (int i = 0; i < RADIX_BUCKETS; i++)
+        free(h->buckets[i].items);
+    memset(h, 0, sizeof(*h));
+}
+
+static inline void radix_clear(RadixHeap* h) {
+    for (int i = 0; i < RADIX_BUCKETS; i++)
+        h->buckets[i].size = 0;
+    h->last = 0;
+    h->size = 0;
+}
+
+static inline int radix_bucket(unsigned key, unsigned last) {
+    return key == last ? 0 : 32 - __builtin_clz(key ^ last);
+}
+
+static inline void radix_append(RadixBucket* b, unsigned long long entry) {
+    if (b->size == b->capacity) {
+        b->capacity = b->capacity ? 2 * b->capacity : 64;
+        b->items = (unsigned long long*)realloc(b->items, b->capacity * sizeof(unsigned long long));
+        if (b->items == NULL) {
+            fprintf(stderr, "Error: Could not grow bucket to %ld entries\n", b->capacity);
+            exit(EXIT_FAILURE);
+        }
+    }
+    b->items[b->size++] = entry;
+}
+
+// key must not be below the last key popped.
+static inline void radix_push(RadixHeap* h, int v, unsigned key) {
+    radix_append(&h->buckets[radix_bucket(key, h->last)],
+                 ((unsigned long long)key << 32) | (unsigned)v);
+    h->size++;
+}
+
+// As dial_pop_bucket: when bucket 0 (keys equal to last) is empty, the
+// lowest non-empty bucket is emptied into the ones below it around its own
+// minimum, which then becomes last.
+static inline long radix_pop_bucket(RadixHeap* h, int* out, long* key) {
+    if (h->size == 0)
+        return 0;
+    if (h->buckets[0].size == 0) {
+        int i = 1;
+        while (h->buckets[i].size == 0)
+            i++;
+        RadixBucket* b = &h->buckets[i];
+        unsigned long long least = b->items[0];
+        for (long j = 1; j < b->size; j++)
+            if (b->items[j] < least)
+                least = b->items[j];
+        h->last = (unsigned)(least >> 32);
+        for (long j = 0; j < b->size; j++)
+            radix_append(&h->buckets[radix_bucket((unsigned)(b->items[j] >> 32), h->last)], b->items[j]);
+        b->size = 0;
+    }
+    RadixBucket* b = &h->buckets[0];
+    long count = b->size;
+    for (long j = 0; j < count; j++)
+        out[j] = (int)(unsigned)b->items[j];
+    b->size = 0;
+    h->size -= count;
+    *key = h->last;
+    return count;
+}
+
+#endif
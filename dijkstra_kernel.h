@@ -0,0 +1,195 @@
+// The heap Dijkstra kernel for one distance type. Include with DIST_TYPE
+// set to a DIST_* id from dist_types.h; every inclusion defines, for the
+// type's suffix <t> (u8, u16, i32, i64, f32):
+//   T* dist_weights_<t>(const Graph* g)        edgeLen converted to T
+//   dijkstra_<t>(const Graph* g, const T* weights, int src, T* dist, int arity)
+//   long dist_mismatches_<t>(const T* dist, const int* expected, int n)
+//                                               vertices that differ from an
+//                                               int result, INT_MAX meaning
+//                                               unreachable
+// plus IndexedHeap_<t> and heap_*_<t>, heap.h's heap keyed on T. Weights
+// and distances both use T, so a u16 run streams half the bytes of an int
+// one. The narrow types add with saturation so a path too long for T
+// stays at infinity instead of wrapping; i32 adds plainly, like the int
+// kernels, which keeps it usable on graphs with negative weights.
+// dijkstra() in DIJKSTRAHEAPOPENMP.c is dijkstra_i32 over g->edgeLen.
+// No include guard: the header is meant to be included once per type.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <omp.h>
+#include "dist_types.h"
+#include "graph.h"
+#include "heap.h"
+#include "instrument.h"
+
+// Out-degree from which a vertex's edges are relaxed by the whole team.
+#ifndef PARALLEL_RELAX_DEGREE
+#define PARALLEL_RELAX_DEGREE 2048
+#endif
+
+#define DK_CAT2(a, b) a##_##b
+#define DK_CAT(a, b) DK_CAT2(a, b)
+#define DK_NAME(x) DK_CAT(x, DK_SUFFIX)
+
+#if DIST_TYPE == DIST_U8
+#define DK_T uint8_t
+#define DK_SUFFIX u8
+#define DK_INF DIST_INF_U8
+#define DK_ADD sat_add_u8
+#elif DIST_TYPE == DIST_U16
+#define DK_T uint16_t
+#define DK_SUFFIX u16
+#define DK_INF DIST_INF_U16
+#define DK_ADD sat_add_u16
+#elif DIST_TYPE == DIST_I32
+#define DK_T int32_t
+#define DK_SUFFIX i32
+#define DK_INF DIST_INF_I32
+#define DK_ADD(a, b) ((a) + (b))
+#elif DIST_TYPE == DIST_I64
+#define DK_T int64_t
+#define DK_SUFFIX i64
+#define DK_INF DIST_INF_I64
+#define DK_ADD sat_add_i64
+#elif DIST_TYPE == DIST_F32
+#define DK_T float
+#define DK_SUFFIX f32
+#define DK_INF DIST_INF_F32
+#define DK_ADD sat_add_f32
+#else
+#error "DIST_TYPE must be one of the DIST_* ids of dist_types.h"
+#endif
+
+// The indexed heap of heap.h, keyed on T.
+#define HEAP_KEY DK_T
+#define HEAP_FN(name) DK_NAME(name)
+#include "heap_impl.h"
+#undef HEAP_KEY
+#undef HEAP_FN
+
+static inline DK_T* DK_NAME(dist_weights)(const Graph* g) {
+    DK_T* weights = (DK_T*)graph_malloc((g->num_edges ? g->num_edges : 1) * sizeof(DK_T), "typed weights");
+    #pragma omp parallel for schedule(static)
+    for (long e = 0; e < g->num_edges; e++)
+        weights[e] = (DK_T)g->edgeLen[e];
+    return weights;
+}
+
+// Relaxes the out-edges of a high-degree vertex. Each thread filters its
+// slice of the edges into scratch without touching shared state; the
+// improving entries are then applied to dist and the heap serially.
+static inline void DK_NAME(relax_hub)(const Graph* g, const DK_T* weights, int u, DK_T* dist,
+                                      DK_NAME(IndexedHeap)* heap, DK_NAME(HeapEntry)* scratch,
+                                      int* counts) {
+    long begin = g->indexofNodes[u];
+    long degree = g->indexofNodes[u + 1] - begin;
+    DK_T du = dist[u];
+    int team = 1;
+
+    #pragma omp parallel
+    {
+        int tid = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        long lo = degree * tid / nt, hi = degree * (tid + 1) / nt;
+        int k = 0;
+        for (long i = lo; i < hi; i++) {
+            int v = g->edgeList[begin + i];
+            DK_T nd = DK_ADD(du, weights[begin + i]);
+            if (nd < dist[v]) {
+                scratch[lo + k].node = v;
+                scratch[lo + k].dist = nd;
+                k++;
+            }
+        }
+        counts[tid] = k;
+        if (tid == 0)
+            team = nt;
+    }
+
+    for (int t = 0; t < team; t++) {
+        long lo = degree * t / team;
+        for (int k = 0; k < counts[t]; k++) {
+            DK_NAME(HeapEntry) x = scratch[lo + k];
+            if (x.dist < dist[x.node]) {
+                dist[x.node] = x.dist;
+                DK_NAME(heap_push_or_decrease)(heap, x.node, x.dist);
+                INSTR_COUNT(COUNT_UPDATES, 1);
+                INSTR_COUNT(COUNT_HEAP_OPS, 1);
+            }
+        }
+    }
+}
+
+// Dijkstra with an indexed d-ary heap. Only the source is queued up front
+// and vertices enter the heap when first reached. Ordinary vertices are
+// relaxed serially; only vertices above PARALLEL_RELAX_DEGREE use the team.
+static inline void DK_NAME(dijkstra)(const Graph* g, const DK_T* weights, int src, DK_T* dist,
+                                     int arity) {
+    int n = g->num_nodes;
+    DK_NAME(IndexedHeap)* heap = DK_NAME(heap_create)(n, arity);
+    long max_degree = 0;
+
+    #pragma omp parallel for reduction(max:max_degree)
+    for (int i = 0; i < n; i++) {
+        dist[i] = DK_INF;
+        if (out_degree(g, i) > max_degree)
+            max_degree = out_degree(g, i);
+    }
+
+    DK_NAME(HeapEntry)* scratch = NULL;
+    int* counts = NULL;
+    if (max_degree >= PARALLEL_RELAX_DEGREE) {
+        scratch = (DK_NAME(HeapEntry)*)graph_malloc(max_degree * sizeof(*scratch), "relax buffer");
+        counts = (int*)graph_malloc(omp_get_max_threads() * sizeof(int), "relax counts");
+    }
+
+    dist[src] = 0;
+    DK_NAME(heap_push_or_decrease)(heap, src, 0);
+
+    while (!DK_NAME(heap_empty)(heap)) {
+        INSTR_BEGIN(PHASE_EXTRACT_MIN);
+        int u = DK_NAME(heap_pop)(heap).node;
+        INSTR_END(PHASE_EXTRACT_MIN);
+        INSTR_COUNT(COUNT_HEAP_OPS, 1);
+        INSTR_COUNT(COUNT_RELAXATIONS, out_degree(g, u));
+        DK_T du = dist[u];
+
+        INSTR_BEGIN(PHASE_RELAX);
+        if (out_degree(g, u) >= PARALLEL_RELAX_DEGREE) {
+            DK_NAME(relax_hub)(g, weights, u, dist, heap, scratch, counts);
+        } else {
+            for (long i = g->indexofNodes[u]; i < g->indexofNodes[u + 1]; i++) {
+                int v = g->edgeList[i];
+                DK_T nd = DK_ADD(du, weights[i]);
+                if (nd < dist[v]) {
+                    dist[v] = nd;
+                    DK_NAME(heap_push_or_decrease)(heap, v, nd);
+                    INSTR_COUNT(COUNT_UPDATES, 1);
+                    INSTR_COUNT(COUNT_HEAP_OPS, 1);
+                }
+            }
+        }
+        INSTR_END(PHASE_RELAX);
+    }
+
+    free(scratch);
+    free(counts);
+    DK_NAME(heap_free)(heap);
+}
+
+static inline long DK_NAME(dist_mismatches)(const DK_T* dist, const int* expected, int n) {
+    long mismatches = 0;
+    #pragma omp parallel for schedule(static) reduction(+:mismatches)
+    for (int v = 0; v < n; v++)
+        if (expected[v] == INT_MAX ? dist[v] != DK_INF : dist[v] != (DK_T)expected[v])
+            mismatches++;
+    return mismatches;
+}
+
+#undef DK_T
+#undef DK_SUFFIX
+#undef DK_INF
+#undef DK_ADD
+#undef DIST_TYPE
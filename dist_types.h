@@ -0,0 +1,146 @@
+#ifndef DIST_TYPES_H
+#define DIST_TYPES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+// Distance types the SSSP and APSP kernels are specialised for. Every type
+// reserves its largest value (INFINITY for float) as "unreachable", and
+// adds saturate there instead of wrapping, so infinity + w stays infinity
+// and the relax loops need no separate reachability check. Weights must be
+// non-negative and, for the integer types, small enough that the longest
+// shortest path stays below infinity; dist_type_for picks such a type.
+//
+// C kernels are stamped out once per type by including a kernel header
+// with DIST_TYPE set to one of the ids below (see floyd_kernel.h and
+// dijkstra_kernel.h); C++ kernels take the type as a template parameter
+// and get the same operations from DistTraits.
+
+#define DIST_U8 0
+#define DIST_U16 1
+#define DIST_I32 2
+#define DIST_I64 3
+#define DIST_F32 4
+#define DIST_TYPES 5
+
+#define DIST_INF_U8 UINT8_MAX
+#define DIST_INF_U16 UINT16_MAX
+#define DIST_INF_I32 INT32_MAX
+#define DIST_INF_I64 INT64_MAX
+#define DIST_INF_F32 INFINITY
+
+static inline const char* dist_type_name(int type) {
+    static const char* names[DIST_TYPES] = { "u8", "u16", "i32", "i64", "f32" };
+    return names[type];
+}
+
+// Returns the type id for "u8", "u16", ..., or -1.
+static inline int parse_dist_type(const char* name) {
+    for (int t = 0; t < DIST_TYPES; t++)
+        if (strcmp(name, dist_type_name(t)) == 0)
+            return t;
+    return -1;
+}
+
+// The saturating adds compile to an add and a conditional move (or a
+// saturating vector add once vectorised); none of them branch.
+static inline uint8_t sat_add_u8(uint8_t a, uint8_t b) {
+    unsigned s = (unsigned)a + b;
+    return (uint8_t)(s < UINT8_MAX ? s : UINT8_MAX);
+}
+
+static inline uint16_t sat_add_u16(uint16_t a, uint16_t b) {
+    unsigned s = (unsigned)a + b;
+    return (uint16_t)(s < UINT16_MAX ? s : UINT16_MAX);
+}
+
+// The signed types carry negative weights (Bellman-Ford): infinity plus
+// anything stays infinity, a positive overflow saturates and any other sum
+// is the plain one, negative results included.
+static inline int32_t sat_add_i32(int32_t a, int32_t b) {
+    return a == INT32_MAX || (b > 0 && a > INT32_MAX - b) ? INT32_MAX : a + b;
+}
+
+static inline int64_t sat_add_i64(int64_t a, int64_t b) {
+    return a == INT64_MAX || (b > 0 && a > INT64_MAX - b) ? INT64_MAX : a + b;
+}
+
+static inline float sat_add_f32(float a, float b) {
+    return a + b;
+}
+
+// Narrowest type that holds every shortest path of a graph with num_nodes
+// vertices and integer weights in [min_weight, max_weight]: a shortest path
+// has at most num_nodes - 1 edges. Negative weights get i32, the kernels'
+// historical type, since the unsigned types cannot hold them.
+static inline int dist_type_for(long min_weight, long max_weight, long num_nodes) {
+    if (min_weight < 0)
+        return DIST_I32;
+    double longest = (double)max_weight * (num_nodes > 1 ? num_nodes - 1 : 1);
+    if (longest < UINT8_MAX)
+        return DIST_U8;
+    if (longest < UINT16_MAX)
+        return DIST_U16;
+    if (longest < INT32_MAX)
+        return DIST_I32;
+    return DIST_I64;
+}
+
+#ifdef __cplusplus
+
+// DistTraits<T>::inf() and add(a, b) for the C++ kernels.
+template <typename T> struct DistTraits;
+
+template <> struct DistTraits<uint8_t> {
+    static const int type = DIST_U8;
+    static uint8_t inf() { return DIST_INF_U8; }
+    static uint8_t add(uint8_t a, uint8_t b) { return sat_add_u8(a, b); }
+};
+
+template <> struct DistTraits<uint16_t> {
+    static const int type = DIST_U16;
+    static uint16_t inf() { return DIST_INF_U16; }
+    static uint16_t add(uint16_t a, uint16_t b) { return sat_add_u16(a, b); }
+};
+
+template <> struct DistTraits<int32_t> {
+    static const int type = DIST_I32;
+    static int32_t inf() { return DIST_INF_I32; }
+    static int32_t add(int32_t a, int32_t b) { return sat_add_i32(a, b); }
+};
+
+template <> struct DistTraits<int64_t> {
+    static const int type = DIST_I64;
+    static int64_t inf() { return DIST_INF_I64; }
+    static int64_t add(int64_t a, int64_t b) { return sat_add_i64(a, b); }
+};
+
+template <> struct DistTraits<float> {
+    static const int type = DIST_F32;
+    static float inf() { return DIST_INF_F32; }
+    static float add(float a, float b) { return sat_add_f32(a, b); }
+};
+
+// Narrows int weights (or distances) to T, INT_MAX becoming T's infinity.
+template <typename T> static inline void distConvert(const int* in, T* out, long count) {
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < count; i++)
+        out[i] = in[i] == INT32_MAX ? DistTraits<T>::inf() : (T)in[i];
+}
+
+// Vertices whose T distance differs from an int result, INT_MAX meaning
+// unreachable.
+template <typename T> static inline long distMismatches(const T* dist, const int* expected, int n) {
+    long mismatches = 0;
+    #pragma omp parallel for schedule(static) reduction(+:mismatches)
+    for (int v = 0; v < n; v++)
+        if (expected[v] == INT32_MAX ? dist[v] != DistTraits<T>::inf() : dist[v] != (T)expected[v])
+            mismatches++;
+    return mismatches;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,475 @@
+#ifndef DYNAMIC_GRAPH_HPP
+#define DYNAMIC_GRAPH_HPP
+
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <omp.h>
+#include "atomicUtil.h"
+#include "graph.h"
+
+// Batched edge updates on a graph that is read by SSSP between batches.
+enum UpdateKind { EDGE_INSERT, EDGE_DELETE, EDGE_WEIGHT };
+
+struct EdgeUpdate {
+    int kind;
+    int u;
+    int v;
+    int weight;   // new weight, unused for EDGE_DELETE
+};
+
+// One direction of a dynamic graph: the CSR arrays of the last compaction
+// plus a short list of inserted edges per vertex. A deleted base edge keeps
+// its slot with weight DELETED_EDGE, so updates never shift the base
+// arrays; compact() folds both back into plain CSR. Weights must be
+// non-negative. When a vertex has several edges to the same neighbour,
+// deletions and weight changes act on the lightest one.
+struct DynamicAdjacency {
+    static const int DELETED_EDGE = -1;
+
+    int n;
+    std::vector<long> index;
+    std::vector<int> nbr;
+    std::vector<int> len;
+    std::vector<std::vector<std::pair<int, int> > > extra;
+    long numExtra;
+    long numDeleted;
+
+    void build(const Graph* g) {
+        n = g->num_nodes;
+        index.assign(g->indexofNodes, g->indexofNodes + n + 1);
+        nbr.resize(g->num_edges);
+        len.resize(g->num_edges);
+        #pragma omp parallel for schedule(static)
+        for (long e = 0; e < g->num_edges; e++) {
+            nbr[e] = g->edgeList[e];
+            len[e] = g->edgeLen[e];
+        }
+        extra.assign(n, std::vector<std::pair<int, int> >());
+        numExtra = 0;
+        numDeleted = 0;
+    }
+
+    long liveEdges() const { return (long)nbr.size() - numDeleted + numExtra; }
+
+    // Calls f(neighbour, weight) for every live out-edge of v.
+    template <class F>
+    void forEach(int v, F f) const {
+        for (long e = index[v]; e < index[v + 1]; e++)
+            if (len[e] != DELETED_EDGE)
+                f(nbr[e], len[e]);
+        for (size_t i = 0; i < extra[v].size(); i++)
+            f(extra[v][i].first, extra[v][i].second);
+    }
+
+    // Position of the lightest live (u, v) edge: a base edge index, or
+    // nbr.size() + i for extra[u][i]; -1 if there is none.
+    long locate(int u, int v) const {
+        long best = -1;
+        int bestLen = INT_MAX;
+        long e = std::lower_bound(nbr.begin() + index[u], nbr.begin() + index[u + 1], v) - nbr.begin();
+        for (; e < index[u + 1] && nbr[e] == v; e++)
+            if (len[e] != DELETED_EDGE && (best < 0 || len[e] < bestLen)) {
+                best = e;
+                bestLen = len[e];
+            }
+        for (size_t i = 0; i < extra[u].size(); i++)
+            if (extra[u][i].first == v && (best < 0 || extra[u][i].second < bestLen)) {
+                best = (long)(nbr.size() + i);
+                bestLen = extra[u][i].second;
+            }
+        return best;
+    }
+
+    // Weight of the lightest live (u, v) edge, INT_MAX if there is none.
+    int weight(int u, int v) const {
+        long pos = locate(u, v);
+        if (pos < 0)
+            return INT_MAX;
+        return pos < (long)nbr.size() ? len[pos] : extra[u][pos - nbr.size()].second;
+    }
+
+    // Applies one update to the out-edges of u. Changes to numExtra and
+    // numDeleted are added to *extraDelta and *deletedDelta instead, so
+    // updates of different vertices can run in parallel. Deleting or
+    // reweighting a missing edge does nothing.
+    void apply(const EdgeUpdate& up, int u, int v, long* extraDelta, long* deletedDelta) {
+        if (up.kind == EDGE_INSERT) {
+            extra[u].push_back(std::make_pair(v, up.weight));
+            (*extraDelta)++;
+            return;
+        }
+        long pos = locate(u, v);
+        if (pos < 0)
+            return;
+        if (pos < (long)nbr.size()) {
+            len[pos] = up.kind == EDGE_WEIGHT ? up.weight : DELETED_EDGE;
+            if (up.kind == EDGE_DELETE)
+                (*deletedDelta)++;
+        } else if (up.kind == EDGE_WEIGHT) {
+            extra[u][pos - nbr.size()].second = up.weight;
+        } else {
+            extra[u][pos - nbr.size()] = extra[u].back();
+            extra[u].pop_back();
+            (*extraDelta)--;
+        }
+    }
+
+    // Rebuilds plain CSR from the live edges, neighbour lists sorted.
+    void compact() {
+        std::vector<long> next(n + 1);
+        #pragma omp parallel for schedule(dynamic, 1024)
+        for (int v = 0; v < n; v++) {
+            long live = (long)extra[v].size();
+            for (long e = index[v]; e < index[v + 1]; e++)
+                live += len[e] != DELETED_EDGE;
+            next[v] = live;
+        }
+        next[n] = 0;
+        long total = prefix_sum(next.data(), n + 1);
+        std::vector<int> newNbr(total), newLen(total);
+        #pragma omp parallel for schedule(dynamic, 1024)
+        for (int v = 0; v < n; v++) {
+            long out = next[v];
+            forEach(v, [&](int x, int w) {
+                newNbr[out] = x;
+                newLen[out++] = w;
+            });
+            sort_neighbors(&newNbr[0] + next[v], &newLen[0] + next[v], out - next[v]);
+            std::vector<std::pair<int, int> >().swap(extra[v]);
+        }
+        index.swap(next);
+        nbr.swap(newNbr);
+        len.swap(newLen);
+        numExtra = 0;
+        numDeleted = 0;
+    }
+};
+
+// Out- and in-edges of a graph under batched updates. An undirected graph
+// applies every update in both directions.
+class DynamicGraph {
+    bool undirected;
+
+public:
+    DynamicAdjacency out;
+    DynamicAdjacency in;
+
+    // Compact once inserted plus deleted edges exceed 1 / COMPACT_DIVISOR
+    // of the live edges.
+    static const int COMPACT_DIVISOR = 8;
+
+    DynamicGraph(const Graph* g, const Graph* rev, bool undirectedGraph) : undirected(undirectedGraph) {
+        out.build(g);
+        in.build(rev);
+    }
+
+    int num_nodes() const { return out.n; }
+    long num_edges() const { return out.liveEdges(); }
+    bool isUndirected() const { return undirected; }
+
+    // Applies a batch in order. Updates are grouped by the vertex whose edge
+    // list they change and the groups applied in parallel, each in batch
+    // order. A negative weight, which could not be told from DELETED_EDGE,
+    // is an error.
+    void apply(const std::vector<EdgeUpdate>& batch) {
+        for (size_t i = 0; i < batch.size(); i++)
+            if (batch[i].kind != EDGE_DELETE && batch[i].weight < 0) {
+                fprintf(stderr, "Error: Edge update (%d, %d) has negative weight %d\n", batch[i].u, batch[i].v,
+                        batch[i].weight);
+                exit(EXIT_FAILURE);
+            }
+        std::vector<EdgeUpdate> directed(batch);
+        if (undirected)
+            for (size_t i = 0; i < batch.size(); i++) {
+                EdgeUpdate mirror = batch[i];
+                std::swap(mirror.u, mirror.v);
+                directed.push_back(mirror);
+            }
+        applySide(out, directed, false);
+        applySide(in, directed, true);
+
+        if ((out.numExtra + out.numDeleted) * COMPACT_DIVISOR > out.liveEdges()) {
+            out.compact();
+            in.compact();
+        }
+    }
+
+    // Plain CSR copy of the current out-edges, freed with free_graph.
+    void snapshot(Graph* g) {
+        int n = out.n;
+        g->num_nodes = n;
+        g->nodeLabel = NULL;
+        g->mapping = NULL;
+        g->mapping_size = 0;
+        g->indexofNodes = (long*)graph_malloc((n + 1) * sizeof(long), "graph offsets");
+        #pragma omp parallel for schedule(dynamic, 1024)
+        for (int v = 0; v < n; v++) {
+            long live = 0;
+            out.forEach(v, [&](int, int) { live++; });
+            g->indexofNodes[v] = live;
+        }
+        g->indexofNodes[n] = 0;
+        g->num_edges = prefix_sum(g->indexofNodes, n + 1);
+        g->edgeList = (int*)graph_malloc(g->num_edges * sizeof(int), "edge list");
+        g->edgeLen = (int*)graph_malloc(g->num_edges * sizeof(int), "edge weights");
+        #pragma omp parallel for schedule(dynamic, 1024)
+        for (int v = 0; v < n; v++) {
+            long e = g->indexofNodes[v];
+            out.forEach(v, [&](int x, int w) {
+                g->edgeList[e] = x;
+                g->edgeLen[e++] = w;
+            });
+            sort_neighbors(g->edgeList + g->indexofNodes[v], g->edgeLen + g->indexofNodes[v],
+                           e - g->indexofNodes[v]);
+        }
+    }
+
+private:
+    static void applySide(DynamicAdjacency& adj, const std::vector<EdgeUpdate>& batch, bool reverse) {
+        std::vector<int> order(batch.size());
+        for (size_t i = 0; i < order.size(); i++)
+            order[i] = (int)i;
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return (reverse ? batch[a].v : batch[a].u) < (reverse ? batch[b].v : batch[b].u);
+        });
+        std::vector<long> groups;
+        for (size_t i = 0; i < order.size(); i++)
+            if (i == 0 || (reverse ? batch[order[i]].v != batch[order[i - 1]].v
+                                   : batch[order[i]].u != batch[order[i - 1]].u))
+                groups.push_back((long)i);
+        groups.push_back((long)order.size());
+
+        long extraDelta = 0, deletedDelta = 0;
+        #pragma omp parallel for schedule(dynamic, 16) reduction(+:extraDelta, deletedDelta)
+        for (long gi = 0; gi < (long)groups.size() - 1; gi++)
+            for (long i = groups[gi]; i < groups[gi + 1]; i++) {
+                const EdgeUpdate& up = batch[order[i]];
+                if (reverse)
+                    adj.apply(up, up.v, up.u, &extraDelta, &deletedDelta);
+                else
+                    adj.apply(up, up.u, up.v, &extraDelta, &deletedDelta);
+            }
+        adj.numExtra += extraDelta;
+        adj.numDeleted += deletedDelta;
+    }
+};
+
+// Distances and shortest-path tree from one source, kept current across
+// update batches. Each vertex holds one packed (distance, parent) word,
+// updated with atomicMinDistParent so the tree always matches the
+// distances.
+//
+// After a batch only the edges it touched are looked at, in the updated
+// graph. A tree edge that is gone or now heavier than the distances it
+// explains invalidates the subtree below it: those vertices are reset,
+// take the best distance offered by their unaffected in-neighbours, and
+// seed a label-correcting search. Every other touched edge is relaxed
+// into the same search, which for insertions and weight drops is all the
+// repair there is (the decrease-only fast path). Vertices outside the
+// affected region are never touched.
+class DynamicSSSP {
+    DynamicGraph& g;
+    int src;
+    std::vector<unsigned long long> state;
+    std::vector<unsigned char> affected;
+    std::vector<unsigned char> queued;
+    std::vector<int> frontier;
+    std::vector<int> next;
+    std::vector<int> marked;
+    long frontierSize;
+    long nextSize;
+
+    static const int CHUNK = 256;
+
+public:
+    long lastAffected;   // vertices invalidated by the last batch
+    long lastSeeds;      // vertices the last repair started from
+
+    DynamicSSSP(DynamicGraph& graph, int source)
+        : g(graph), src(source), state(graph.num_nodes()), affected(graph.num_nodes()),
+          queued(graph.num_nodes()), frontier(graph.num_nodes()), next(graph.num_nodes()),
+          marked(graph.num_nodes()), frontierSize(0), nextSize(0), lastAffected(0), lastSeeds(0) {
+        recompute();
+    }
+
+    int dist(int v) const { return packedDist(state[v]); }
+    int parent(int v) const { return packedParent(state[v]); }
+
+    void distances(int* out) const {
+        #pragma omp parallel for schedule(static)
+        for (int v = 0; v < g.num_nodes(); v++)
+            out[v] = dist(v);
+    }
+
+    // Full computation from the source with the same parallel search.
+    void recompute() {
+        int n = g.num_nodes();
+        #pragma omp parallel for schedule(static)
+        for (int v = 0; v < n; v++) {
+            state[v] = packDistParent(INT_MAX, -1);
+            affected[v] = 0;
+            queued[v] = 0;
+        }
+        state[src] = packDistParent(0, -1);
+        frontier[0] = src;
+        frontierSize = 1;
+        propagate();
+    }
+
+    // Applies the batch to the graph and repairs distances and tree.
+    void update(const std::vector<EdgeUpdate>& batch) {
+        g.apply(batch);
+        bool both = g.isUndirected();
+
+        // Tree edges that no longer carry their distance root the invalid subtrees.
+        long numMarked = 0;
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (long i = 0; i < (long)batch.size(); i++) {
+            checkTreeEdge(batch[i].u, batch[i].v, &numMarked);
+            if (both)
+                checkTreeEdge(batch[i].v, batch[i].u, &numMarked);
+        }
+        numMarked = markSubtrees(numMarked);
+        lastAffected = numMarked;
+
+        // Invalid vertices restart from their best unaffected in-neighbour.
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (long i = 0; i < numMarked; i++) {
+            int v = marked[i];
+            unsigned long long best = packDistParent(INT_MAX, -1);
+            g.in.forEach(v, [&](int x, int w) {
+                if (affected[x])
+                    return;
+                int dx = packedDist(__atomic_load_n(&state[x], __ATOMIC_RELAXED));
+                if (dx != INT_MAX && dx + w < packedDist(best))
+                    best = packDistParent(dx + w, x);
+            });
+            state[v] = best;
+        }
+        frontierSize = 0;
+        #pragma omp parallel for schedule(static)
+        for (long i = 0; i < numMarked; i++)
+            if (dist(marked[i]) != INT_MAX)
+                enqueue(marked[i]);
+
+        // Decrease-only fast path: relax every touched edge that still exists.
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (long i = 0; i < (long)batch.size(); i++) {
+            relaxSeed(batch[i].u, batch[i].v);
+            if (both)
+                relaxSeed(batch[i].v, batch[i].u);
+        }
+
+        #pragma omp parallel for schedule(static)
+        for (long i = 0; i < numMarked; i++)
+            affected[marked[i]] = 0;
+        lastSeeds = frontierSize;
+        propagate();
+    }
+
+private:
+    void checkTreeEdge(int u, int v, long* numMarked) {
+        int du = dist(u);
+        if (parent(v) != u || du == INT_MAX)
+            return;
+        int w = g.out.weight(u, v);
+        if ((w == INT_MAX || du + w > dist(v)) && testAndSetFlag(&affected[v]))
+            marked[__atomic_fetch_add(numMarked, 1, __ATOMIC_RELAXED)] = v;
+    }
+
+    void relaxSeed(int u, int v) {
+        int du = packedDist(__atomic_load_n(&state[u], __ATOMIC_RELAXED));
+        if (affected[u] || du == INT_MAX)
+            return;
+        int w = g.out.weight(u, v);
+        if (w != INT_MAX && atomicMinDistParent(&state[v], du + w, u))
+            enqueue(v);
+    }
+
+    void enqueue(int v) {
+        if (testAndSetFlag(&queued[v]))
+            frontier[__atomic_fetch_add(&frontierSize, 1, __ATOMIC_RELAXED)] = v;
+    }
+
+    // Extends marked[0 .. numMarked) to every vertex whose tree path runs
+    // through one of them, one tree level per round. Returns the new count.
+    long markSubtrees(long numMarked) {
+        long done = 0;
+        while (done < numMarked) {
+            long end = numMarked;
+            #pragma omp parallel
+            {
+                int local[CHUNK];
+                int k = 0;
+                #pragma omp for schedule(dynamic, 64)
+                for (long i = done; i < end; i++) {
+                    int x = marked[i];
+                    g.out.forEach(x, [&](int y, int) {
+                        if (parent(y) == x && testAndSetFlag(&affected[y])) {
+                            if (k == CHUNK) {
+                                long at = __atomic_fetch_add(&numMarked, k, __ATOMIC_RELAXED);
+                                std::copy(local, local + k, marked.begin() + at);
+                                k = 0;
+                            }
+                            local[k++] = y;
+                        }
+                    });
+                }
+                if (k > 0) {
+                    long at = __atomic_fetch_add(&numMarked, k, __ATOMIC_RELAXED);
+                    std::copy(local, local + k, marked.begin() + at);
+                }
+            }
+            done = end;
+        }
+        return numMarked;
+    }
+
+    // Label-correcting search from frontier[0 .. frontierSize): every
+    // vertex whose distance drops is queued once per round through the
+    // queued flags and relaxed in the next.
+    void propagate() {
+        #pragma omp parallel
+        {
+            while (frontierSize > 0) {
+                int local[CHUNK];
+                int k = 0;
+                #pragma omp for schedule(dynamic, 64) nowait
+                for (long i = 0; i < frontierSize; i++) {
+                    int u = frontier[i];
+                    clearFlag(&queued[u]);
+                    int du = packedDist(__atomic_load_n(&state[u], __ATOMIC_RELAXED));
+                    g.out.forEach(u, [&](int v, int w) {
+                        if (du + w < packedDist(__atomic_load_n(&state[v], __ATOMIC_RELAXED)) &&
+                            atomicMinDistParent(&state[v], du + w, u) &&
+                            testAndSetFlag(&queued[v])) {
+                            if (k == CHUNK) {
+                                long at = __atomic_fetch_add(&nextSize, k, __ATOMIC_RELAXED);
+                                std::copy(local, local + k, next.begin() + at);
+                                k = 0;
+                            }
+                            local[k++] = v;
+                        }
+                    });
+                }
+                if (k > 0) {
+                    long at = __atomic_fetch_add(&nextSize, k, __ATOMIC_RELAXED);
+                    std::copy(local, local + k, next.begin() + at);
+                }
+                #pragma omp barrier
+                #pragma omp single
+                {
+                    frontier.swap(next);
+                    frontierSize = nextSize;
+                    nextSize = 0;
+                }
+            }
+        }
+    }
+};
+
+#endif
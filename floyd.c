@@ -1,81 +1,233 @@
-
 #include <stdio.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include <time.h>
 #include <omp.h>
+#include <immintrin.h>
+
+#include "bench.h"
+#include "dist_types.h"
 
 
 #define N 1200
 
+// Tile edge length. Three int tiles (diagonal, row/column and the one being
+// updated) take 3 * 64 * 64 * 4 = 48 KB, which stays in L1/L2 on the
+// machines we run on; narrower distance types shrink that further. Must be
+// a multiple of the vector length in elements, 64 for u8 with AVX-512.
+#ifndef TILE
+#define TILE 64
+#endif
+
 
 #ifndef min
 #define min(a,b)   (((a) < (b)) ? (a) : (b))
 #endif
 
-int distance_matrix[N][N] = {0};
+// One blocked kernel per distance type: floyd_blocked_u8, _u16, _i32, ...
+#define DIST_TYPE DIST_U8
+#include "floyd_kernel.h"
+#define DIST_TYPE DIST_U16
+#include "floyd_kernel.h"
+#define DIST_TYPE DIST_I32
+#include "floyd_kernel.h"
+#define DIST_TYPE DIST_I64
+#include "floyd_kernel.h"
+#define DIST_TYPE DIST_F32
+#include "floyd_kernel.h"
+
+static size_t dist_type_size(int type)
+{
+  switch (type) {
+  case DIST_U8:  return sizeof(uint8_t);
+  case DIST_U16: return sizeof(uint16_t);
+  case DIST_I64: return sizeof(int64_t);
+  case DIST_F32: return sizeof(float);
+  default:       return sizeof(int32_t);
+  }
+}
+
+typedef struct {
+  int* initial;
+  void* distance_matrix;
+  long n;
+  int type;
+} FloydRun;
+
+static void reset_matrix(void* arg)
+{
+  FloydRun* r = (FloydRun*)arg;
+  long count = r->n * r->n;
+  switch (r->type) {
+  case DIST_U8:  floyd_load_u8((uint8_t*)r->distance_matrix, r->initial, count); break;
+  case DIST_U16: floyd_load_u16((uint16_t*)r->distance_matrix, r->initial, count); break;
+  case DIST_I64: floyd_load_i64((int64_t*)r->distance_matrix, r->initial, count); break;
+  case DIST_F32: floyd_load_f32((float*)r->distance_matrix, r->initial, count); break;
+  default:       floyd_load_i32((int32_t*)r->distance_matrix, r->initial, count);
+  }
+}
+
+static void run_floyd(void* arg)
+{
+  FloydRun* r = (FloydRun*)arg;
+  switch (r->type) {
+  case DIST_U8:  floyd_blocked_u8((uint8_t*)r->distance_matrix, r->n); break;
+  case DIST_U16: floyd_blocked_u16((uint16_t*)r->distance_matrix, r->n); break;
+  case DIST_I64: floyd_blocked_i64((int64_t*)r->distance_matrix, r->n); break;
+  case DIST_F32: floyd_blocked_f32((float*)r->distance_matrix, r->n); break;
+  default:       floyd_blocked_i32((int32_t*)r->distance_matrix, r->n);
+  }
+}
+
+static long floyd_mismatches(const FloydRun* r, const int* expected, long nodes)
+{
+  switch (r->type) {
+  case DIST_U8:  return floyd_mismatches_u8((const uint8_t*)r->distance_matrix, expected, r->n, nodes);
+  case DIST_U16: return floyd_mismatches_u16((const uint16_t*)r->distance_matrix, expected, r->n, nodes);
+  case DIST_I64: return floyd_mismatches_i64((const int64_t*)r->distance_matrix, expected, r->n, nodes);
+  case DIST_F32: return floyd_mismatches_f32((const float*)r->distance_matrix, expected, r->n, nodes);
+  default:       return floyd_mismatches_i32((const int32_t*)r->distance_matrix, expected, r->n, nodes);
+  }
+}
+
+// Weights 0..19 keep every sum below 128, so the carries into the upper
+// bytes of the wide adds are never exercised by the main run. This reruns
+// the i32 and i64 kernels on a small matrix with weights up to 1000 and
+// some missing edges, against a scalar reference.
+static long check_large_weights(void)
+{
+  long n = 2 * TILE;
+  size_t bytes = n * n * sizeof(int);
+  int* initial = (int*)aligned_alloc(64, bytes);
+  int* expected = (int*)aligned_alloc(64, bytes);
+  void* matrix = aligned_alloc(64, n * n * sizeof(int64_t));
+  if (initial == NULL || expected == NULL || matrix == NULL) {
+    fprintf(stderr, "Error: Could not allocate memory for %ld x %ld matrix\n", n, n);
+    exit(EXIT_FAILURE);
+  }
+  for (long i = 0; i < n * n; i++)
+    initial[i] = i / n == i % n ? 0 : rand() % 8 == 0 ? INT_MAX : 1 + rand() % 1000;
+
+  memcpy(expected, initial, bytes);
+  for (long k = 0; k < n; k++)
+    for (long i = 0; i < n; i++)
+      for (long j = 0; j < n; j++)
+        if (expected[i * n + k] != INT_MAX && expected[k * n + j] != INT_MAX)
+          expected[i * n + j] = min(expected[i * n + j], expected[i * n + k] + expected[k * n + j]);
 
+  long mismatches = 0;
+  FloydRun run = { initial, matrix, n, DIST_I32 };
+  reset_matrix(&run);
+  run_floyd(&run);
+  mismatches += floyd_mismatches(&run, expected, n);
+  run.type = DIST_I64;
+  reset_matrix(&run);
+  run_floyd(&run);
+  mismatches += floyd_mismatches(&run, expected, n);
+
+  free(initial);
+  free(expected);
+  free(matrix);
+  return mismatches;
+}
+
+// floyd [nodes] [u8|u16|i32|i64|f32|auto] --threads 1-16 --reps 5 --csv results.csv
 int main(int argc, char *argv[])
 {
-  int nthreads;
-  int src, dst, middle;
-  
+  long src, dst, middle;
+  BenchConfig cfg;
+  bench_parse_args(&argc, argv, &cfg);
+  long nodes = argc > 1 ? atol(argv[1]) : N;
+  long n = (nodes + TILE - 1) / TILE * TILE;   // padded to whole tiles
+  size_t bytes = n * n * sizeof(int);
+
+  // Distances are between 0 and 19, so by default the narrowest type that
+  // holds 19 * (nodes - 1); u16 for the default size.
+  int type = dist_type_for(0, 19, nodes);
+  if (argc > 2 && strcmp(argv[2], "auto") != 0) {
+    type = parse_dist_type(argv[2]);
+    if (type < 0) {
+      fprintf(stderr, "Error: unknown distance type %s (u8, u16, i32, i64, f32 or auto)\n", argv[2]);
+      return 1;
+    }
+  }
+
+  int* initial = (int*)aligned_alloc(64, bytes);
+  // Large enough for the picked type and for the i32 baseline
+  size_t elem = dist_type_size(type) > sizeof(int32_t) ? dist_type_size(type) : sizeof(int32_t);
+  void* distance_matrix = aligned_alloc(64, n * n * elem);
+  int* expected = (int*)aligned_alloc(64, bytes);
+  if (initial == NULL || distance_matrix == NULL || expected == NULL) {
+    fprintf(stderr, "Error: Could not allocate memory for %ld x %ld matrix\n", n, n);
+    return 1;
+  }
+
   //Initialize the graph with random distances
-  for (src = 0; src < N; src++)
+  for (src = 0; src < n; src++)
   {
-    for (dst = 0; dst < N; dst++)
+    for (dst = 0; dst < n; dst++)
     {
-      // Distance from node to same node is 0. So, skipping these elements
-      if(src != dst) {
+      if (src == dst) {
+        // Distance from node to same node is 0
+        initial[src * n + dst] = 0;
+      } else if (src >= nodes || dst >= nodes) {
+        // Padding vertices are unreachable; the kernels saturate at infinity
+        initial[src * n + dst] = INT_MAX;
+      } else {
         //Distances are generated to be between 0 and 19
-        distance_matrix[src][dst] = rand() % 20;
+        initial[src * n + dst] = rand() % 20;
       }
     }
   }
-  
+  // Each update is one add and one min
+  double ops = 2.0 * nodes * nodes * nodes;
+
+  memcpy(expected, initial, bytes);
   double start_time = omp_get_wtime();
-  
-  for (middle = 0; middle < N; middle++)
+
+  for (middle = 0; middle < nodes; middle++)
   {
-    int * dm=distance_matrix[middle];
-    for (src = 0; src < N; src++)
+    int * dm=expected + middle * n;
+    for (src = 0; src < nodes; src++)
     {
-      int * ds=distance_matrix[src];
-      for (dst = 0; dst < N; dst++)
+      int * ds=expected + src * n;
+      for (dst = 0; dst < nodes; dst++)
       {
         ds[dst]=min(ds[dst],ds[middle]+dm[dst]);
       }
     }
   }
-  
+
   double time = omp_get_wtime() - start_time;
-  printf("Total time for sequential (in sec):%.2f\n", time);
-  
-  for(nthreads=1; nthreads <= 16; nthreads++) {
-    //Define different number of threads
-    omp_set_num_threads(nthreads);
-    
-
-    double start_time = omp_get_wtime();
-    
-    #pragma omp parallel shared(distance_matrix)
-    for (middle = 0; middle < N; middle++)
-    {
-      int * dm=distance_matrix[middle];
-      #pragma omp parallel for private(src, dst) schedule(dynamic)
-      for (src = 0; src < N; src++)
-      {
-        int * ds=distance_matrix[src];
-        for (dst = 0; dst < N; dst++)
-        {
-          ds[dst]=min(ds[dst],ds[middle]+dm[dst]);
-        }
-      }
-    }
-    
-    double time = omp_get_wtime() - start_time;
-    printf("Total time for thread %d (in sec):%.2f\n", nthreads, time);
+  printf("Total time for sequential (in sec):%.4f, %.2f GFLOP-eq/s\n", time, ops / time / 1e9);
+
+  char input[64];
+  snprintf(input, sizeof(input), "%ld nodes", nodes);
+  char kernel[64];
+  FloydRun run = { initial, distance_matrix, n, type };
+  snprintf(kernel, sizeof(kernel), "floyd-blocked-%s", dist_type_name(type));
+  bench_run(&cfg, kernel, input, reset_matrix, run_floyd, &run, ops / 1e9, "GFLOP-eq/s");
+  long mismatches = floyd_mismatches(&run, expected, nodes);
+  if (mismatches)
+    printf("RESULT DIFFERS in %ld entries (%s)\n", mismatches, dist_type_name(type));
+
+  // The int kernel as a baseline for the narrower types
+  if (type != DIST_I32) {
+    run.type = DIST_I32;
+    bench_run(&cfg, "floyd-blocked-i32", input, reset_matrix, run_floyd, &run, ops / 1e9, "GFLOP-eq/s");
+    mismatches = floyd_mismatches(&run, expected, nodes);
+    if (mismatches)
+      printf("RESULT DIFFERS in %ld entries (i32)\n", mismatches);
   }
+
+  mismatches = check_large_weights();
+  printf("Large-weight check (i32, i64): %s\n", mismatches ? "RESULTS DIFFER" : "results match");
+
+  free(initial);
+  free(distance_matrix);
+  free(expected);
   return 0;
-  
-}
\ No newline at end of file
+
+}
@@ -0,0 +1,276 @@
+// Blocked Floyd-Warshall for one distance type. Include with DIST_TYPE set
+// to a DIST_* id from dist_types.h and TILE defined; every inclusion
+// defines, for the type's suffix <t> (u8, u16, i32, i64, f32):
+//   floyd_blocked_<t>(T* dist, long n)          the kernel, n a multiple of TILE
+//   floyd_load_<t>(T* dst, const int* src, long count)
+//                                               converts an int matrix, INT_MAX
+//                                               becoming the type's infinity
+//   floyd_mismatches_<t>(const T* dist, const int* expected, long n, long nodes)
+//                                               entries that differ from an int
+//                                               reference over the first nodes
+// No include guard: the header is meant to be included once per type.
+
+#include <stdint.h>
+#include <limits.h>
+#include <immintrin.h>
+#include "dist_types.h"
+
+#define FW_CAT2(a, b) a##_##b
+#define FW_CAT(a, b) FW_CAT2(a, b)
+#define FW_NAME(x) FW_CAT(x, FW_SUFFIX)
+
+// Per type: element type, infinity, scalar saturating add and, where the
+// instruction set has them, vector load/store/broadcast, saturating add
+// (FW_VADD_BODY over a and b) and min (FW_VMIN_BODY).
+#if DIST_TYPE == DIST_U8
+#define FW_T uint8_t
+#define FW_SUFFIX u8
+#define FW_INF DIST_INF_U8
+#define FW_SADD sat_add_u8
+#if defined(__AVX512BW__)
+#define FW_VEC __m512i
+#define FW_VLEN 64
+#define FW_VSET1(x) _mm512_set1_epi8((char)(x))
+#define FW_VADD_BODY _mm512_adds_epu8(a, b)
+#define FW_VMIN_BODY _mm512_min_epu8(a, b)
+#elif defined(__AVX2__)
+#define FW_VEC __m256i
+#define FW_VLEN 32
+#define FW_VSET1(x) _mm256_set1_epi8((char)(x))
+#define FW_VADD_BODY _mm256_adds_epu8(a, b)
+#define FW_VMIN_BODY _mm256_min_epu8(a, b)
+#endif
+
+#elif DIST_TYPE == DIST_U16
+#define FW_T uint16_t
+#define FW_SUFFIX u16
+#define FW_INF DIST_INF_U16
+#define FW_SADD sat_add_u16
+#if defined(__AVX512BW__)
+#define FW_VEC __m512i
+#define FW_VLEN 32
+#define FW_VSET1(x) _mm512_set1_epi16((short)(x))
+#define FW_VADD_BODY _mm512_adds_epu16(a, b)
+#define FW_VMIN_BODY _mm512_min_epu16(a, b)
+#elif defined(__AVX2__)
+#define FW_VEC __m256i
+#define FW_VLEN 16
+#define FW_VSET1(x) _mm256_set1_epi16((short)(x))
+#define FW_VADD_BODY _mm256_adds_epu16(a, b)
+#define FW_VMIN_BODY _mm256_min_epu16(a, b)
+#endif
+
+// No saturating 32/64-bit adds: add as unsigned, which cannot wrap for
+// non-negative operands, then clamp to infinity with an unsigned min.
+#elif DIST_TYPE == DIST_I32
+#define FW_T int32_t
+#define FW_SUFFIX i32
+#define FW_INF DIST_INF_I32
+#define FW_SADD sat_add_i32
+#if defined(__AVX512F__)
+#define FW_VEC __m512i
+#define FW_VLEN 16
+#define FW_VSET1(x) _mm512_set1_epi32(x)
+#define FW_VADD_BODY _mm512_min_epu32(_mm512_add_epi32(a, b), _mm512_set1_epi32(INT32_MAX))
+#define FW_VMIN_BODY _mm512_min_epi32(a, b)
+#elif defined(__AVX2__)
+#define FW_VEC __m256i
+#define FW_VLEN 8
+#define FW_VSET1(x) _mm256_set1_epi32(x)
+#define FW_VADD_BODY _mm256_min_epu32(_mm256_add_epi32(a, b), _mm256_set1_epi32(INT32_MAX))
+#define FW_VMIN_BODY _mm256_min_epi32(a, b)
+#endif
+
+#elif DIST_TYPE == DIST_I64
+#define FW_T int64_t
+#define FW_SUFFIX i64
+#define FW_INF DIST_INF_I64
+#define FW_SADD sat_add_i64
+#if defined(__AVX512F__)
+#define FW_VEC __m512i
+#define FW_VLEN 8
+#define FW_VSET1(x) _mm512_set1_epi64(x)
+#define FW_VADD_BODY _mm512_min_epu64(_mm512_add_epi64(a, b), _mm512_set1_epi64(INT64_MAX))
+#define FW_VMIN_BODY _mm512_min_epi64(a, b)
+#elif defined(__AVX2__)
+// A wrapped sum has its sign bit set; min is a compare and blend. The
+// blend picks bytes by their own top bit, so the mask must be the
+// full-width sign compare, not the sum.
+static inline __m256i fw_sat_add_i64_avx2(__m256i a, __m256i b) {
+    __m256i s = _mm256_add_epi64(a, b);
+    return _mm256_blendv_epi8(s, _mm256_set1_epi64x(INT64_MAX),
+                              _mm256_cmpgt_epi64(_mm256_setzero_si256(), s));
+}
+#define FW_VEC __m256i
+#define FW_VLEN 4
+#define FW_VSET1(x) _mm256_set1_epi64x(x)
+#define FW_VADD_BODY fw_sat_add_i64_avx2(a, b)
+#define FW_VMIN_BODY _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b))
+#endif
+
+#elif DIST_TYPE == DIST_F32
+#define FW_T float
+#define FW_SUFFIX f32
+#define FW_INF DIST_INF_F32
+#define FW_SADD sat_add_f32
+#if defined(__AVX512F__)
+#define FW_VEC __m512
+#define FW_VLEN 16
+#define FW_VLOAD(p) _mm512_load_ps(p)
+#define FW_VSTORE(p, x) _mm512_store_ps(p, x)
+#define FW_VSET1(x) _mm512_set1_ps(x)
+#define FW_VADD_BODY _mm512_add_ps(a, b)
+#define FW_VMIN_BODY _mm512_min_ps(a, b)
+#elif defined(__AVX__)
+#define FW_VEC __m256
+#define FW_VLEN 8
+#define FW_VLOAD(p) _mm256_load_ps(p)
+#define FW_VSTORE(p, x) _mm256_store_ps(p, x)
+#define FW_VSET1(x) _mm256_set1_ps(x)
+#define FW_VADD_BODY _mm256_add_ps(a, b)
+#define FW_VMIN_BODY _mm256_min_ps(a, b)
+#endif
+
+#else
+#error "DIST_TYPE must be one of the DIST_* ids of dist_types.h"
+#endif
+
+#if !defined(FW_VEC)
+#define FW_VEC FW_T
+#define FW_VLEN 1
+#define FW_VLOAD(p) (*(p))
+#define FW_VSTORE(p, x) (*(p) = (x))
+#define FW_VSET1(x) (x)
+#define FW_VADD_BODY FW_SADD(a, b)
+#define FW_VMIN_BODY (b < a ? b : a)
+#endif
+
+// Integer vectors load and store through the si512/si256 forms.
+#if !defined(FW_VLOAD)
+#if defined(__AVX512F__) && (DIST_TYPE == DIST_I32 || DIST_TYPE == DIST_I64 || defined(__AVX512BW__))
+#define FW_VLOAD(p) _mm512_load_si512((const void*)(p))
+#define FW_VSTORE(p, x) _mm512_store_si512((void*)(p), x)
+#else
+#define FW_VLOAD(p) _mm256_load_si256((const __m256i*)(p))
+#define FW_VSTORE(p, x) _mm256_store_si256((__m256i*)(p), x)
+#endif
+#endif
+
+#if TILE % FW_VLEN != 0
+#error "TILE must be a multiple of the vector length of every distance type"
+#endif
+
+static inline FW_VEC FW_NAME(fw_vadd)(FW_VEC a, FW_VEC b) {
+    return FW_VADD_BODY;
+}
+
+static inline FW_VEC FW_NAME(fw_vmin)(FW_VEC a, FW_VEC b) {
+    return FW_VMIN_BODY;
+}
+
+// C = min(C, A (min,+) B) for one tile when C does not alias A or B. Each
+// row of C is held in registers while the whole of B streams past it.
+static void FW_NAME(minplus_tile)(FW_T* C, const FW_T* A, const FW_T* B, long stride) {
+    for (int i = 0; i < TILE; i++) {
+        FW_VEC c[TILE / FW_VLEN];
+        FW_T* crow = C + i * stride;
+        for (int v = 0; v < TILE / FW_VLEN; v++)
+            c[v] = FW_VLOAD(crow + v * FW_VLEN);
+        for (int k = 0; k < TILE; k++) {
+            FW_VEC a = FW_VSET1(A[i * stride + k]);
+            const FW_T* brow = B + k * stride;
+            for (int v = 0; v < TILE / FW_VLEN; v++)
+                c[v] = FW_NAME(fw_vmin)(c[v], FW_NAME(fw_vadd)(a, FW_VLOAD(brow + v * FW_VLEN)));
+        }
+        for (int v = 0; v < TILE / FW_VLEN; v++)
+            FW_VSTORE(crow + v * FW_VLEN, c[v]);
+    }
+}
+
+// Same update for the diagonal, row and column tiles, where C aliases A
+// or B and the middle vertex k has to be the outer loop.
+static void FW_NAME(minplus_tile_inplace)(FW_T* C, const FW_T* A, const FW_T* B, long stride) {
+    for (int k = 0; k < TILE; k++) {
+        const FW_T* brow = B + k * stride;
+        for (int i = 0; i < TILE; i++) {
+            FW_VEC a = FW_VSET1(A[i * stride + k]);
+            FW_T* crow = C + i * stride;
+            for (int v = 0; v < TILE / FW_VLEN; v++)
+                FW_VSTORE(crow + v * FW_VLEN,
+                          FW_NAME(fw_vmin)(FW_VLOAD(crow + v * FW_VLEN),
+                                           FW_NAME(fw_vadd)(a, FW_VLOAD(brow + v * FW_VLEN))));
+        }
+    }
+}
+
+// Blocked Floyd-Warshall over an n x n matrix with n a multiple of TILE.
+// For every diagonal tile kb: update the diagonal tile, then the tiles in
+// its row and column (which only depend on the diagonal), then every other
+// tile (which only depends on its row and column tiles).
+void FW_NAME(floyd_blocked)(FW_T* dist, long n) {
+    long tiles = n / TILE;
+
+    #pragma omp parallel
+    for (long kb = 0; kb < tiles; kb++) {
+        FW_T* diag = dist + kb * TILE * n + kb * TILE;
+
+        #pragma omp single
+        FW_NAME(minplus_tile_inplace)(diag, diag, diag, n);
+
+        #pragma omp for schedule(static)
+        for (long t = 0; t < 2 * tiles; t++) {
+            long b = t % tiles;
+            if (b == kb)
+                continue;
+            if (t < tiles) {
+                FW_T* row = dist + kb * TILE * n + b * TILE;
+                FW_NAME(minplus_tile_inplace)(row, diag, row, n);
+            } else {
+                FW_T* col = dist + b * TILE * n + kb * TILE;
+                FW_NAME(minplus_tile_inplace)(col, col, diag, n);
+            }
+        }
+
+        #pragma omp for collapse(2) schedule(static)
+        for (long ib = 0; ib < tiles; ib++) {
+            for (long jb = 0; jb < tiles; jb++) {
+                if (ib == kb || jb == kb)
+                    continue;
+                FW_NAME(minplus_tile)(dist + ib * TILE * n + jb * TILE,
+                                      dist + ib * TILE * n + kb * TILE,
+                                      dist + kb * TILE * n + jb * TILE, n);
+            }
+        }
+    }
+}
+
+void FW_NAME(floyd_load)(FW_T* dst, const int* src, long count) {
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < count; i++)
+        dst[i] = src[i] == INT_MAX ? FW_INF : (FW_T)src[i];
+}
+
+long FW_NAME(floyd_mismatches)(const FW_T* dist, const int* expected, long n, long nodes) {
+    long mismatches = 0;
+    #pragma omp parallel for schedule(static) reduction(+:mismatches)
+    for (long i = 0; i < nodes; i++)
+        for (long j = 0; j < nodes; j++) {
+            int e = expected[i * n + j];
+            if (e == INT_MAX ? dist[i * n + j] != FW_INF : dist[i * n + j] != (FW_T)e)
+                mismatches++;
+        }
+    return mismatches;
+}
+
+#undef FW_T
+#undef FW_SUFFIX
+#undef FW_INF
+#undef FW_SADD
+#undef FW_VEC
+#undef FW_VLEN
+#undef FW_VLOAD
+#undef FW_VSTORE
+#undef FW_VSET1
+#undef FW_VADD_BODY
+#undef FW_VMIN_BODY
+#undef DIST_TYPE
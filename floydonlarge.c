@@ -1,114 +1,368 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <omp.h>
 #include <limits.h>
-#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "graph.h"
+#include "graph_gen.h"
+#include "sssp.h"
+#include "numa.h"
 
 #define N 40000
+// Above this size the dense O(N^2) reference check is skipped.
+#define DENSE_CHECK_LIMIT 4096
+// Encoded rows are collected per thread and flushed in blocks of this size.
+#define ROW_BUFFER_BYTES (4L << 20)
+
+#define SINK_NONE 0
+#define SINK_RAW 1
+#define SINK_COMPRESSED 2
+#define SINK_MATRIX 3
+
+Graph graph;
+// Per-node copies of graph under --numa replicate.
+GraphReplicas replicas;
 
+// Destination of the finished distance rows. SINK_RAW writes the n x n int
+// matrix with one pwrite per row at its final offset. SINK_COMPRESSED
+// appends varint-coded rows and finishes with an index of (offset, length)
+// per source. SINK_MATRIX keeps the rows in memory for the dense check.
 typedef struct {
-    int dst;
-    int weight;
-} Edge;
+    int mode;
+    int fd;
+    long n;
+    int* matrix;
+    long next_offset;
+    long* index;
+    long bytes;
+} RowSink;
 
+// Per-thread block of encoded rows waiting to be written.
 typedef struct {
-    int num_edges;
-    Edge* edges;
-} Node;
+    unsigned char* data;
+    long used;
+    long capacity;
+    int count;
+    int* sources;
+    long* lengths;
+} RowBuffer;
+
+#define COMPRESSED_MAGIC "APSPVZ01"
+#define COMPRESSED_HEADER 64
+
+// Each distance is stored as a varint of zigzag(d) + 1 (at most 5 bytes),
+// with 0 for unreachable, so the short distances of typical graphs take
+// one byte.
+static long encode_row(const int* dist, long n, unsigned char* out) {
+    long used = 0;
+    for (long v = 0; v < n; v++) {
+        unsigned long x = dist[v] == INT_MAX ? 0 :
+            ((unsigned long)(((long)dist[v] << 1) ^ ((long)dist[v] >> 63))) + 1;
+        while (x >= 0x80) {
+            out[used++] = (unsigned char)(x | 0x80);
+            x >>= 7;
+        }
+        out[used++] = (unsigned char)x;
+    }
+    return used;
+}
+
+static void write_at(int fd, const void* data, long bytes, long offset) {
+    const char* p = (const char*)data;
+    while (bytes > 0) {
+        ssize_t done = pwrite(fd, p, bytes, offset);
+        if (done <= 0) {
+            fprintf(stderr, "Error: Could not write APSP output\n");
+            exit(EXIT_FAILURE);
+        }
+        p += done;
+        bytes -= done;
+        offset += done;
+    }
+}
 
-Node* graph[N];
+static void open_sink(RowSink* sink, const char* path, long n, int* matrix) {
+    memset(sink, 0, sizeof(*sink));
+    sink->n = n;
+    sink->fd = -1;
+    if (matrix != NULL) {
+        sink->mode = SINK_MATRIX;
+        sink->matrix = matrix;
+        return;
+    }
+    if (path == NULL) {
+        sink->mode = SINK_NONE;
+        return;
+    }
+    size_t len = strlen(path);
+    sink->mode = len > 3 && strcmp(path + len - 3, ".vz") == 0 ? SINK_COMPRESSED : SINK_RAW;
+    sink->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (sink->fd < 0) {
+        fprintf(stderr, "Error: Could not open file %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    if (sink->mode == SINK_COMPRESSED) {
+        sink->next_offset = COMPRESSED_HEADER;
+        sink->index = (long*)graph_malloc(2 * n * sizeof(long), "row index");
+    }
+}
 
-void initialize_graph() {
-    int i;
-    for (i = 0; i < N; i++) {
-        graph[i] = (Node*)malloc(sizeof(Node));
-        graph[i]->num_edges = 0;
-        graph[i]->edges = NULL;
+static void flush_rows(RowSink* sink, RowBuffer* buf) {
+    if (buf->count == 0)
+        return;
+    long offset;
+    #pragma omp atomic capture
+    { offset = sink->next_offset; sink->next_offset += buf->used; }
+
+    write_at(sink->fd, buf->data, buf->used, offset);
+    for (int r = 0; r < buf->count; r++) {
+        sink->index[2 * buf->sources[r]] = offset;
+        sink->index[2 * buf->sources[r] + 1] = buf->lengths[r];
+        offset += buf->lengths[r];
     }
+    #pragma omp atomic
+    sink->bytes += buf->used;
+    buf->used = 0;
+    buf->count = 0;
 }
 
-void add_edge(int src, int dst, int weight) {
-    graph[src]->num_edges++;
-    graph[src]->edges = (Edge*)realloc(graph[src]->edges, graph[src]->num_edges * sizeof(Edge));
-    graph[src]->edges[graph[src]->num_edges - 1].dst = dst;
-    graph[src]->edges[graph[src]->num_edges - 1].weight = weight;
+static void emit_row(RowSink* sink, RowBuffer* buf, int src, const int* dist) {
+    long n = sink->n;
+    if (sink->mode == SINK_MATRIX) {
+        memcpy(sink->matrix + src * n, dist, n * sizeof(int));
+    } else if (sink->mode == SINK_RAW) {
+        write_at(sink->fd, dist, n * sizeof(int), src * n * sizeof(int));
+        #pragma omp atomic
+        sink->bytes += n * sizeof(int);
+    } else if (sink->mode == SINK_COMPRESSED) {
+        if (buf->capacity - buf->used < 5 * n)
+            flush_rows(sink, buf);
+        long len = encode_row(dist, n, buf->data + buf->used);
+        buf->sources[buf->count] = src;
+        buf->lengths[buf->count] = len;
+        buf->used += len;
+        buf->count++;
+    }
+}
+
+static void close_sink(RowSink* sink) {
+    if (sink->mode == SINK_COMPRESSED) {
+        long index_offset = sink->next_offset;
+        write_at(sink->fd, sink->index, 2 * sink->n * sizeof(long), index_offset);
+        unsigned char header[COMPRESSED_HEADER] = {0};
+        memcpy(header, COMPRESSED_MAGIC, 8);
+        memcpy(header + 8, &sink->n, sizeof(long));
+        memcpy(header + 16, &index_offset, sizeof(long));
+        write_at(sink->fd, header, COMPRESSED_HEADER, 0);
+        free(sink->index);
+    }
+    if (sink->fd >= 0)
+        close(sink->fd);
 }
 
-void floyd_warshall_sparse(int **dist) {
-    int k, i, j;
-    #pragma omp parallel for private(k, i, j) schedule(dynamic)
-    for (k = 0; k < N; k++) {
-        for (i = 0; i < N; i++) {
-            if (dist[i][k] == INT_MAX) continue;
-            for (j = 0; j < graph[i]->num_edges; j++) {
-                int dst = graph[i]->edges[j].dst;
-                if(dist[k][dst] == INT_MAX) continue;
-                int weight = graph[i]->edges[j].weight;
-                if (dist[i][dst] > dist[i][k] + dist[k][dst]) {
-                    dist[i][dst] = dist[i][k] + dist[k][dst];
-                }
+// Johnson potentials: h[v] is the shortest distance to v from a virtual
+// source joined to every vertex by a zero-weight edge, computed with
+// Bellman-Ford. Returns 0 if the graph has a negative cycle.
+static int johnson_potentials(const Graph* g, long* h) {
+    int n = g->num_nodes;
+    for (int v = 0; v < n; v++)
+        h[v] = 0;
+    for (int round = 0; round <= n; round++) {
+        int changed = 0;
+        #pragma omp parallel for schedule(dynamic, 1024) reduction(|:changed)
+        for (int v = 0; v < n; v++) {
+            for (long e = g->indexofNodes[v]; e < g->indexofNodes[v + 1]; e++) {
+                int u = g->edgeList[e];
+                long nd = h[v] + g->edgeLen[e];
+                long old = __atomic_load_n(&h[u], __ATOMIC_RELAXED);
+                while (nd < old && !__atomic_compare_exchange_n(&h[u], &old, nd, 1,
+                                                               __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                    ;
+                if (nd < old)
+                    changed = 1;
             }
         }
+        if (!changed)
+            return 1;
     }
+    return 0;
 }
 
-int main(int argc, char* argv[]) {
-    int num_threads = 12;  
-
-    initialize_graph();
-
-    // Add edges with random weights between 0 and 19
-    srand(time(NULL));
-    int i, j;
-    for (i = 0; i < N; i++) {
-        for (j = 0; j < 1; j++) {  // Each node connects to 1 other node on average
-            int dst = rand() % N;
-            if (dst != i) {
-                int weight = rand() % 20;
-                add_edge(i, dst, weight);
-            }
+// All-pairs shortest paths as one Dijkstra per source, sources spread over
+// the threads. Every thread owns one heap, one distance row and one output
+// buffer, so scratch memory is O(threads * V) rather than the O(V^2) of a
+// dense matrix. Negative weights are handled with Johnson's reweighting.
+void apsp_sparse(const Graph* g, RowSink* sink) {
+    int n = g->num_nodes;
+    const Graph* search = g;
+    Graph reweighted;
+    long* h = NULL;
+
+    bool negative = false;
+    for (long e = 0; e < g->num_edges; e++)
+        if (g->edgeLen[e] < 0)
+            negative = true;
+    if (negative) {
+        h = (long*)graph_malloc(n * sizeof(long), "Johnson potentials");
+        if (!johnson_potentials(g, h)) {
+            fprintf(stderr, "Error: Graph has a negative cycle\n");
+            exit(EXIT_FAILURE);
         }
+        reweighted = *g;
+        reweighted.edgeLen = (int*)graph_malloc(g->num_edges * sizeof(int), "edge weights");
+        #pragma omp parallel for schedule(dynamic, 1024)
+        for (int u = 0; u < n; u++)
+            for (long e = g->indexofNodes[u]; e < g->indexofNodes[u + 1]; e++)
+                reweighted.edgeLen[e] = (int)(g->edgeLen[e] + h[u] - h[g->edgeList[e]]);
+        search = &reweighted;
     }
 
-    // Allocate and initialize distance matrix
-    int **dist = (int **)malloc(N * sizeof(int *));
-    int k;
-    for (i = 0; i < N; i++) {
-        dist[i] = (int *)malloc(N * sizeof(int));
-        for (j = 0; j < N; j++) {
-            if (i == j) {
-                dist[i][j] = 0;
-            } else {
-                dist[i][j] = INT_MAX;
-            }
+    #pragma omp parallel
+    {
+        IndexedHeap* heap = heap_create(n, 4);
+        int* dist = (int*)graph_malloc(n * sizeof(int), "distance row");
+        RowBuffer buf;
+        memset(&buf, 0, sizeof(buf));
+        if (sink->mode == SINK_COMPRESSED) {
+            buf.capacity = ROW_BUFFER_BYTES > 5L * n ? ROW_BUFFER_BYTES : 5L * n;
+            buf.data = (unsigned char*)graph_malloc(buf.capacity, "row buffer");
+            buf.sources = (int*)graph_malloc((buf.capacity / n + 1) * sizeof(int), "row buffer");
+            buf.lengths = (long*)graph_malloc((buf.capacity / n + 1) * sizeof(long), "row buffer");
         }
+
+        const Graph* local = search == &graph ? graph_replica(&replicas, &graph) : search;
+        #pragma omp for schedule(dynamic, 16)
+        for (int src = 0; src < n; src++) {
+            dijkstra_serial(local, src, dist, heap);
+            if (h != NULL)
+                for (int v = 0; v < n; v++)
+                    if (dist[v] != INT_MAX)
+                        dist[v] = (int)(dist[v] - h[src] + h[v]);
+            emit_row(sink, &buf, src, dist);
+        }
+        if (sink->mode == SINK_COMPRESSED)
+            flush_rows(sink, &buf);
+
+        free(buf.data);
+        free(buf.sources);
+        free(buf.lengths);
+        free(dist);
+        heap_free(heap);
     }
 
-    // Initialize distances based on edges
-    for (i = 0; i < N; i++) {
-        for (j = 0; j < graph[i]->num_edges; j++) {
-            int dst = graph[i]->edges[j].dst;
-            int weight = graph[i]->edges[j].weight;
-            dist[i][dst] = weight;
+    if (h != NULL) {
+        free(reweighted.edgeLen);
+        free(h);
+    }
+}
+
+// Dense reference: Floyd-Warshall with the k loop outside the parallel
+// loop, as the recurrence requires.
+void floyd_warshall_dense(int* dist, long n) {
+    for (long k = 0; k < n; k++) {
+        const int* dk = dist + k * n;
+        #pragma omp parallel for schedule(static)
+        for (long i = 0; i < n; i++) {
+            int* di = dist + i * n;
+            if (di[k] == INT_MAX) continue;
+            for (long j = 0; j < n; j++)
+                if (dk[j] != INT_MAX && di[k] + dk[j] < di[j])
+                    di[j] = di[k] + dk[j];
         }
     }
+}
 
-    omp_set_num_threads(num_threads);
+// Timed runs only compute the rows; writing them is done once afterwards.
+static void run_apsp(void* arg) {
+    RowSink sink;
+    open_sink(&sink, NULL, ((const Graph*)arg)->num_nodes, NULL);
+    apsp_sparse((const Graph*)arg, &sink);
+}
 
-    double start_time = omp_get_wtime();
+int main(int argc, char* argv[]) {
+    BenchConfig cfg;
+    // Usage: floydonlarge [nodes | generator spec, see graph_gen.h] [output file, .vz for compressed]
+    //                     --threads 1-16 --numa first-touch --bind spread --csv results.csv
+    bench_parse_args(&argc, argv, &cfg);
+    int policy = parse_numa_policy(cfg.numa);
+    if (cfg.reorder != NULL)
+        fprintf(stderr, "Warning: --reorder is ignored here; rows are written by generated vertex id\n");
+    const char* output = argc > 2 && strcmp(argv[2], "-") != 0 ? argv[2] : NULL;
+
+    // Default workload: one random out-edge per vertex, weights 0..19.
+    GenParams params;
+    gen_default_params(&params);
+    params.min_weight = 0;
+    params.max_weight = 19;
+    if (argc < 2 || !parse_gen_spec(argv[1], &params)) {
+        params.kind = GEN_UNIFORM;
+        params.num_nodes = argc > 1 ? atol(argv[1]) : N;
+        params.num_edges = params.num_nodes;
+    }
+    double gen_start = omp_get_wtime();
+    generate_graph(&graph, &params);
+    long n = graph.num_nodes;
+    printf("Generated %ld nodes, %ld edges (in sec): %.4f\n", n, graph.num_edges,
+           omp_get_wtime() - gen_start);
+    numa_place_graph(&graph, policy, &replicas);
 
-    floyd_warshall_sparse(dist);
+    char input[64];
+    snprintf(input, sizeof(input), "%ld nodes, %ld edges, %s", n, graph.num_edges, numa_policy_name(policy));
+    bench_run(&cfg, "apsp-sparse", input, NULL, run_apsp, &graph, (double)n, "sources/s");
 
+    RowSink sink;
+    open_sink(&sink, output, n, NULL);
+    double start_time = omp_get_wtime();
+    apsp_sparse(&graph, &sink);
     double elapsed_time = omp_get_wtime() - start_time;
-    printf("Total time for %d threads (in sec): %.2f\n", num_threads, elapsed_time);
+    close_sink(&sink);
+    printf("Scratch memory per thread (in MB): %.2f\n",
+           (n * (sizeof(HeapEntry) + 2 * sizeof(int)) +
+            (sink.mode == SINK_COMPRESSED ? ROW_BUFFER_BYTES : 0)) / 1e6);
+    if (sink.mode != SINK_NONE)
+        printf("Wrote %s in %.2f s: %.1f MB (%.2f bytes per distance)\n", output, elapsed_time,
+               sink.bytes / 1e6, (double)sink.bytes / ((double)n * n));
+
+    if (n <= DENSE_CHECK_LIMIT) {
+        // Allocate and initialize distance matrix, each row first touched
+        // by the thread floyd_warshall_dense gives it (same static schedule)
+        // unless --numa serial asks for the old master-thread placement.
+        int* dist = (int*)numa_alloc(n * n * sizeof(int), policy, "distance matrix");
+        int* rows = (int*)numa_alloc(n * n * sizeof(int), policy, "distance matrix");
+        #pragma omp parallel for schedule(static) if (policy != NUMA_SERIAL)
+        for (long i = 0; i < n; i++) {
+            for (long j = 0; j < n; j++)
+                dist[i * n + j] = i == j ? 0 : INT_MAX;
+            if (policy != NUMA_SERIAL)
+                memset(rows + i * n, 0, n * sizeof(int));
+            // Initialize distances based on edges
+            for (long e = graph.indexofNodes[i]; e < graph.indexofNodes[i + 1]; e++)
+                if (graph.edgeLen[e] < dist[i * n + graph.edgeList[e]])
+                    dist[i * n + graph.edgeList[e]] = graph.edgeLen[e];
+        }
 
-    // Free the graph memory
-    for (i = 0; i < N; i++) {
-        free(graph[i]->edges);
-        free(graph[i]);
-        free(dist[i]);
+        start_time = omp_get_wtime();
+        floyd_warshall_dense(dist, n);
+        elapsed_time = omp_get_wtime() - start_time;
+
+        open_sink(&sink, NULL, n, rows);
+        apsp_sparse(&graph, &sink);
+        long mismatches = 0;
+        for (long k = 0; k < n * n; k++)
+            if (dist[k] != rows[k])
+                mismatches++;
+        printf("Dense Floyd-Warshall check (in sec): %.2f, %s\n", elapsed_time,
+               mismatches ? "RESULTS DIFFER" : "results match");
+        free(dist);
+        free(rows);
     }
-    free(dist);
+
+    graph_replicas_free(&replicas);
+    free_graph(&graph);
 
     return 0;
 }
@@ -0,0 +1,211 @@
+// Packed, register-blocked GEMM for one element type. Included once per type
+// by matrixmultiplication.c with GEMM_T (element type) and GEMM_FN(name)
+// (name mangling) defined; there is deliberately no include guard.
+//
+// C (m x n) += A (m x k) * B (k x n), all row-major with leading dimensions
+// lda, ldb, ldc. Loop nest after Goto/BLIS:
+//   jc: NC columns of B, sized for the L3 cache
+//   pc: KC deep slice; the KC x NC panel of B is packed once (L3)
+//   ic: MC rows of A; the MC x KC block of A is packed (L2)
+//   jr/ir: NR x MR micro-tiles computed by the micro-kernel, with the
+//          KC x NR sliver of B staying in L1
+// Each (ic, jr-group) macro-tile is independent, so the team splits those.
+
+#if !defined(GEMM_T) || !defined(GEMM_FN)
+#error "define GEMM_T and GEMM_FN before including gemm_impl.h"
+#endif
+
+typedef GEMM_T GEMM_FN(vec) __attribute__((vector_size(GEMM_VECTOR_BYTES)));
+
+#define GEMM_VLEN ((int)(GEMM_VECTOR_BYTES / sizeof(GEMM_T)))
+#define GEMM_NR (2 * GEMM_VLEN)
+
+// Packs rows [0, mc) x columns [0, kc) of A into MR-row slivers, column by
+// column, zero-filling the last sliver.
+static void GEMM_FN(pack_a)(long mc, long kc, const GEMM_T* A, long lda, GEMM_T* Ap) {
+    long slivers = (mc + GEMM_MR - 1) / GEMM_MR;
+    for (long s = 0; s < slivers; s++) {
+        GEMM_T* dst = Ap + s * kc * GEMM_MR;
+        for (long p = 0; p < kc; p++)
+            for (int i = 0; i < GEMM_MR; i++) {
+                long row = s * GEMM_MR + i;
+                dst[p * GEMM_MR + i] = row < mc ? A[row * lda + p] : (GEMM_T)0;
+            }
+    }
+}
+
+// Packs rows [0, kc) x columns [0, nc) of B into NR-column slivers, row by
+// row, zero-filling the last sliver.
+static void GEMM_FN(pack_b)(long kc, long nc, const GEMM_T* B, long ldb, GEMM_T* Bp) {
+    long slivers = (nc + GEMM_NR - 1) / GEMM_NR;
+    #pragma omp for schedule(static)
+    for (long s = 0; s < slivers; s++) {
+        GEMM_T* dst = Bp + s * kc * GEMM_NR;
+        long width = nc - s * GEMM_NR < GEMM_NR ? nc - s * GEMM_NR : GEMM_NR;
+        for (long p = 0; p < kc; p++) {
+            const GEMM_T* src = B + p * ldb + s * GEMM_NR;
+            for (int j = 0; j < GEMM_NR; j++)
+                dst[p * GEMM_NR + j] = j < width ? src[j] : (GEMM_T)0;
+        }
+    }
+}
+
+// MR x NR micro-kernel: 2 * MR vector accumulators stay in registers for
+// the whole kc loop. Edge tiles are computed in full and only the valid
+// mr x nr part is added to C.
+static void GEMM_FN(micro_kernel)(long kc, const GEMM_T* a, const GEMM_T* b,
+                                  GEMM_T* C, long ldc, int mr, int nr) {
+    GEMM_FN(vec) c0[GEMM_MR], c1[GEMM_MR];
+    for (int i = 0; i < GEMM_MR; i++) {
+        c0[i] = (GEMM_FN(vec)){0};
+        c1[i] = (GEMM_FN(vec)){0};
+    }
+
+    for (long p = 0; p < kc; p++) {
+        GEMM_FN(vec) b0 = *(const GEMM_FN(vec)*)(b + p * GEMM_NR);
+        GEMM_FN(vec) b1 = *(const GEMM_FN(vec)*)(b + p * GEMM_NR + GEMM_VLEN);
+        for (int i = 0; i < GEMM_MR; i++) {
+            GEMM_T ai = a[p * GEMM_MR + i];
+            c0[i] += ai * b0;
+            c1[i] += ai * b1;
+        }
+    }
+
+    if (mr == GEMM_MR && nr == GEMM_NR) {
+        for (int i = 0; i < GEMM_MR; i++) {
+            GEMM_T* row = C + i * ldc;
+            for (int j = 0; j < GEMM_VLEN; j++) {
+                row[j] += c0[i][j];
+                row[GEMM_VLEN + j] += c1[i][j];
+            }
+        }
+    } else {
+        for (int i = 0; i < mr; i++) {
+            GEMM_T* row = C + i * ldc;
+            for (int j = 0; j < nr; j++)
+                row[j] += j < GEMM_VLEN ? c0[i][j] : c1[i][j - GEMM_VLEN];
+        }
+    }
+}
+
+// Block sizes derived from the cache sizes: a KC x NR sliver of B fills
+// half of L1, an MC x KC block of A half of L2 and a KC x NC panel of B
+// half of L3.
+static void GEMM_FN(block_sizes)(long* mc, long* kc, long* nc) {
+    *kc = (GEMM_L1_BYTES / 2) / (GEMM_NR * (long)sizeof(GEMM_T));
+    *mc = (GEMM_L2_BYTES / 2) / (*kc * (long)sizeof(GEMM_T)) / GEMM_MR * GEMM_MR;
+    *nc = (GEMM_L3_BYTES / 2) / (*kc * (long)sizeof(GEMM_T)) / GEMM_NR * GEMM_NR;
+    if (*mc < GEMM_MR) *mc = GEMM_MR;
+    if (*nc < GEMM_NR) *nc = GEMM_NR;
+}
+
+void GEMM_FN(gemm)(long m, long n, long k, const GEMM_T* A, long lda,
+                   const GEMM_T* B, long ldb, GEMM_T* C, long ldc) {
+    long MC, KC, NC;
+    GEMM_FN(block_sizes)(&MC, &KC, &NC);
+    if (NC > n) NC = (n + GEMM_NR - 1) / GEMM_NR * GEMM_NR;
+    if (KC > k) KC = k;
+
+    long m_blocks = (m + MC - 1) / MC;
+    long a_stride = ((MC + GEMM_MR - 1) / GEMM_MR) * GEMM_MR * KC;
+    GEMM_T* Ap = (GEMM_T*)aligned_alloc(64, ((m_blocks * a_stride * sizeof(GEMM_T) + 63) / 64) * 64);
+    GEMM_T* Bp = (GEMM_T*)aligned_alloc(64, ((KC * NC * sizeof(GEMM_T) + 63) / 64) * 64);
+    if (Ap == NULL || Bp == NULL) {
+        fprintf(stderr, "Error: Could not allocate GEMM packing buffers\n");
+        exit(EXIT_FAILURE);
+    }
+
+    #pragma omp parallel
+    for (long jc = 0; jc < n; jc += NC) {
+        long nc = n - jc < NC ? n - jc : NC;
+        // Groups of NR slivers handed out together, so a thread reuses its
+        // packed A block across several B slivers.
+        long jr_group = 4 * GEMM_NR;
+        long n_groups = (nc + jr_group - 1) / jr_group;
+
+        for (long pc = 0; pc < k; pc += KC) {
+            long kc = k - pc < KC ? k - pc : KC;
+
+            GEMM_FN(pack_b)(kc, nc, B + pc * ldb + jc, ldb, Bp);
+            #pragma omp for schedule(static)
+            for (long ib = 0; ib < m_blocks; ib++) {
+                long mc = m - ib * MC < MC ? m - ib * MC : MC;
+                GEMM_FN(pack_a)(mc, kc, A + ib * MC * lda + pc, lda, Ap + ib * a_stride);
+            }
+
+            #pragma omp for collapse(2) schedule(dynamic, 1)
+            for (long ib = 0; ib < m_blocks; ib++) {
+                for (long g = 0; g < n_groups; g++) {
+                    long ic = ib * MC;
+                    long mc = m - ic < MC ? m - ic : MC;
+                    long j_end = (g + 1) * jr_group < nc ? (g + 1) * jr_group : nc;
+                    for (long jr = g * jr_group; jr < j_end; jr += GEMM_NR) {
+                        int nr = j_end - jr < GEMM_NR ? (int)(j_end - jr) : GEMM_NR;
+                        for (long ir = 0; ir < mc; ir += GEMM_MR) {
+                            int mr = mc - ir < GEMM_MR ? (int)(mc - ir) : GEMM_MR;
+                            GEMM_FN(micro_kernel)(kc, Ap + ib * a_stride + ir * kc,
+                                                  Bp + jr * kc, C + (ic + ir) * ldc + jc + jr,
+                                                  ldc, mr, nr);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    free(Ap);
+    free(Bp);
+}
+
+// The original kernel: i-j-k loop straight over row-major C += A * B, with
+// rows handed out dynamically. Serial when parallel is 0, which is the
+// reference the packed version is checked against.
+void GEMM_FN(gemm_loop)(long m, long n, long k, const GEMM_T* A, const GEMM_T* B,
+                        GEMM_T* C, int parallel) {
+    #pragma omp parallel for schedule(dynamic) if(parallel)
+    for (long i = 0; i < m; ++i)
+        for (long j = 0; j < n; ++j)
+            for (long p = 0; p < k; ++p)
+                C[i * n + j] += A[i * k + p] * B[p * n + j];
+}
+
+// Multiply-add throughput of the current team: every thread keeps 2 * MR
+// independent accumulators busy, the same shape as the micro-kernel, so
+// this is the ceiling the GEMM can reach on this machine. peak_run is one
+// timed pass, doing peak_ops() operations (a multiply-add counts as two);
+// the caller times it like any other kernel.
+#define GEMM_PEAK_ITERATIONS (20000000 / GEMM_VLEN)
+
+static volatile GEMM_T GEMM_FN(peak_one) = 1, GEMM_FN(peak_sink);
+
+double GEMM_FN(peak_ops)(void) {
+    return 2.0 * 2 * GEMM_MR * GEMM_VLEN * GEMM_PEAK_ITERATIONS * omp_get_max_threads();
+}
+
+void GEMM_FN(peak_run)(void) {
+    const long iterations = GEMM_PEAK_ITERATIONS;
+    GEMM_T sink = 0;
+    #pragma omp parallel reduction(+:sink)
+    {
+        GEMM_FN(vec) acc[2 * GEMM_MR];
+        // Loaded through a volatile so the loop cannot be folded away.
+        GEMM_FN(vec) x = (GEMM_FN(vec)){0} + GEMM_FN(peak_one);
+        GEMM_FN(vec) y = (GEMM_FN(vec)){0} + (GEMM_T)omp_get_thread_num();
+        for (int i = 0; i < 2 * GEMM_MR; i++)
+            acc[i] = (GEMM_FN(vec)){0} + (GEMM_T)i;
+        // Fully unrolled so acc stays in registers; a loop over it goes
+        // through the stack and measures store forwarding instead.
+        for (long it = 0; it < iterations; it++) {
+            #pragma GCC unroll 32
+            for (int i = 0; i < 2 * GEMM_MR; i++)
+                acc[i] = acc[i] * x + y;
+        }
+        for (int i = 0; i < 2 * GEMM_MR; i++)
+            sink += acc[i][0];
+    }
+    GEMM_FN(peak_sink) = sink;
+}
+
+#undef GEMM_PEAK_ITERATIONS
+#undef GEMM_VLEN
+#undef GEMM_NR
@@ -0,0 +1,256 @@
+#ifndef GRAPH_H
+#define GRAPH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <sys/mman.h>
+#include <omp.h>
+
+// Compressed sparse row graph shared by all SSSP/APSP programs.
+// The out-edges of vertex v are edgeList[indexofNodes[v] .. indexofNodes[v+1]-1]
+// and edgeLen holds the weight of each edge at the same position.
+typedef struct {
+    int num_nodes;
+    long num_edges;
+    long* indexofNodes;
+    int* edgeList;
+    int* edgeLen;
+    long long* nodeLabel;   // input id of each vertex, NULL when ids were already dense
+    void* mapping;          // read-only snapshot the arrays point into, see graph_io.h
+    size_t mapping_size;
+} Graph;
+
+static inline void* graph_malloc(size_t bytes, const char* what) {
+    void* p = malloc(bytes ? bytes : 1);
+    if (p == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for %s\n", what);
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static inline long out_degree(const Graph* g, int v) {
+    return g->indexofNodes[v + 1] - g->indexofNodes[v];
+}
+
+// Exclusive prefix sum of a[0..n-1] in place, returns the total.
+static inline long prefix_sum(long* a, int n) {
+    int max_threads = omp_get_max_threads();
+    long* partial = (long*)graph_malloc((max_threads + 1) * sizeof(long), "prefix sums");
+    long total = 0;
+    partial[0] = 0;
+
+    #pragma omp parallel
+    {
+        int tid = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        int begin = (int)((long)n * tid / nt);
+        int end = (int)((long)n * (tid + 1) / nt);
+
+        long sum = 0;
+        for (int i = begin; i < end; i++)
+            sum += a[i];
+        partial[tid + 1] = sum;
+
+        #pragma omp barrier
+        #pragma omp single
+        {
+            for (int t = 1; t <= nt; t++)
+                partial[t] += partial[t - 1];
+            total = partial[nt];
+        }
+
+        long run = partial[tid];
+        for (int i = begin; i < end; i++) {
+            long d = a[i];
+            a[i] = run;
+            run += d;
+        }
+    }
+
+    free(partial);
+    return total;
+}
+
+// LSD radix sort, 8 bits per pass. Passes in which every key has the same
+// digit are skipped, so small ids and weights cost only a few passes.
+static inline void radix_sort_u64(unsigned long long* keys, unsigned long long* tmp, long len) {
+    unsigned long long* in = keys;
+    unsigned long long* out = tmp;
+    for (int shift = 0; shift < 64; shift += 8) {
+        long count[257] = {0};
+        for (long i = 0; i < len; i++)
+            count[((in[i] >> shift) & 255) + 1]++;
+        if (count[((in[0] >> shift) & 255) + 1] == len)
+            continue;
+        for (int d = 0; d < 256; d++)
+            count[d + 1] += count[d];
+        for (long i = 0; i < len; i++)
+            out[count[(in[i] >> shift) & 255]++] = in[i];
+        unsigned long long* t = in;
+        in = out;
+        out = t;
+    }
+    if (in != keys)
+        memcpy(keys, in, len * sizeof(unsigned long long));
+}
+
+// Sorts a neighbour list by target, ties by signed weight. The radix keys
+// flip the sign bit of the weight so that unsigned key order is signed
+// weight order, the same as the insertion sort for short lists.
+static inline void sort_neighbors(int* dst, int* w, long len) {
+    if (len > 32) {
+        unsigned long long* keys = (unsigned long long*)graph_malloc(2 * len * sizeof(unsigned long long), "neighbour sort");
+        for (long i = 0; i < len; i++)
+            keys[i] = ((unsigned long long)(unsigned)dst[i] << 32) | ((unsigned)w[i] ^ 0x80000000u);
+        radix_sort_u64(keys, keys + len, len);
+        for (long i = 0; i < len; i++) {
+            dst[i] = (int)(keys[i] >> 32);
+            w[i] = (int)((unsigned)keys[i] ^ 0x80000000u);
+        }
+        free(keys);
+        return;
+    }
+    for (long i = 1; i < len; i++) {
+        int d = dst[i], x = w[i];
+        long j = i - 1;
+        while (j >= 0 && (dst[j] > d || (dst[j] == d && w[j] > x))) {
+            dst[j + 1] = dst[j];
+            w[j + 1] = w[j];
+            j--;
+        }
+        dst[j + 1] = d;
+        w[j + 1] = x;
+    }
+}
+
+static inline void sort_all_neighbors(Graph* g) {
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int v = 0; v < g->num_nodes; v++) {
+        long begin = g->indexofNodes[v];
+        sort_neighbors(g->edgeList + begin, g->edgeLen + begin, g->indexofNodes[v + 1] - begin);
+    }
+}
+
+// Builds the CSR arrays from an edge list in parallel. weight may be NULL
+// for unit weights. With undirected set, every pair is stored in both
+// directions. Neighbour lists are sorted so the result does not depend on
+// the thread count.
+static inline void build_graph(Graph* g, int num_nodes, long num_pairs,
+                               const int* src, const int* dst, const int* weight,
+                               bool undirected) {
+    g->num_nodes = num_nodes;
+    g->nodeLabel = NULL;
+    g->mapping = NULL;
+    g->mapping_size = 0;
+    g->indexofNodes = (long*)graph_malloc((num_nodes + 1) * sizeof(long), "graph offsets");
+
+    #pragma omp parallel for schedule(static)
+    for (int v = 0; v <= num_nodes; v++)
+        g->indexofNodes[v] = 0;
+
+    #pragma omp parallel for schedule(static)
+    for (long e = 0; e < num_pairs; e++) {
+        #pragma omp atomic
+        g->indexofNodes[src[e]]++;
+        if (undirected) {
+            #pragma omp atomic
+            g->indexofNodes[dst[e]]++;
+        }
+    }
+
+    g->num_edges = prefix_sum(g->indexofNodes, num_nodes + 1);
+    g->edgeList = (int*)graph_malloc(g->num_edges * sizeof(int), "edge list");
+    g->edgeLen = (int*)graph_malloc(g->num_edges * sizeof(int), "edge weights");
+
+    long* cursor = (long*)graph_malloc(num_nodes * sizeof(long), "graph cursors");
+    #pragma omp parallel for schedule(static)
+    for (int v = 0; v < num_nodes; v++)
+        cursor[v] = g->indexofNodes[v];
+
+    #pragma omp parallel for schedule(static)
+    for (long e = 0; e < num_pairs; e++) {
+        int w = weight ? weight[e] : 1;
+        long pos;
+        #pragma omp atomic capture
+        pos = cursor[src[e]]++;
+        g->edgeList[pos] = dst[e];
+        g->edgeLen[pos] = w;
+        if (undirected) {
+            #pragma omp atomic capture
+            pos = cursor[dst[e]]++;
+            g->edgeList[pos] = src[e];
+            g->edgeLen[pos] = w;
+        }
+    }
+    free(cursor);
+
+    sort_all_neighbors(g);
+}
+
+// Builds the reverse graph: every edge u->v of g becomes v->u in t with the
+// same weight. Used by pull-style sweeps and backward searches.
+static inline void transpose_graph(const Graph* g, Graph* t) {
+    int n = g->num_nodes;
+    t->num_nodes = n;
+    t->nodeLabel = NULL;
+    t->mapping = NULL;
+    t->mapping_size = 0;
+    t->indexofNodes = (long*)graph_malloc((n + 1) * sizeof(long), "graph offsets");
+
+    #pragma omp parallel for schedule(static)
+    for (int v = 0; v <= n; v++)
+        t->indexofNodes[v] = 0;
+
+    #pragma omp parallel for schedule(static)
+    for (long e = 0; e < g->num_edges; e++) {
+        #pragma omp atomic
+        t->indexofNodes[g->edgeList[e]]++;
+    }
+
+    t->num_edges = prefix_sum(t->indexofNodes, n + 1);
+    t->edgeList = (int*)graph_malloc(t->num_edges * sizeof(int), "edge list");
+    t->edgeLen = (int*)graph_malloc(t->num_edges * sizeof(int), "edge weights");
+
+    long* cursor = (long*)graph_malloc(n * sizeof(long), "graph cursors");
+    #pragma omp parallel for schedule(static)
+    for (int v = 0; v < n; v++)
+        cursor[v] = t->indexofNodes[v];
+
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int u = 0; u < n; u++) {
+        for (long e = g->indexofNodes[u]; e < g->indexofNodes[u + 1]; e++) {
+            long pos;
+            #pragma omp atomic capture
+            pos = cursor[g->edgeList[e]]++;
+            t->edgeList[pos] = u;
+            t->edgeLen[pos] = g->edgeLen[e];
+        }
+    }
+    free(cursor);
+
+    sort_all_neighbors(t);
+}
+
+static inline void free_graph(Graph* g) {
+    if (g->mapping != NULL) {
+        munmap(g->mapping, g->mapping_size);
+    } else {
+        free(g->indexofNodes);
+        free(g->edgeList);
+        free(g->edgeLen);
+        free(g->nodeLabel);
+    }
+    g->mapping = NULL;
+    g->mapping_size = 0;
+    g->indexofNodes = NULL;
+    g->edgeList = NULL;
+    g->edgeLen = NULL;
+    g->nodeLabel = NULL;
+    g->num_nodes = 0;
+    g->num_edges = 0;
+}
+
+#endif
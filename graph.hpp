@@ -0,0 +1,83 @@
+#ifndef GRAPH_HPP
+#define GRAPH_HPP
+
+#include <climits>
+#include <cstdio>
+#include "graph_io.h"
+#include "graph_reorder.h"
+
+// C++ view of the shared CSR Graph for the Bellman-Ford and delta-stepping
+// programs. The arrays are owned by the underlying Graph and are valid after
+// parseGraph().
+class graph {
+    Graph g;
+    Graph rev;
+    const char* filePath;
+    bool undirected;
+
+public:
+    long* indexofNodes;
+    int* edgeList;
+
+    graph(const char* file, bool undirectedGraph = false)
+        : filePath(file), undirected(undirectedGraph), indexofNodes(NULL), edgeList(NULL) {
+        memset(&g, 0, sizeof(g));
+        memset(&rev, 0, sizeof(rev));
+    }
+
+    ~graph() {
+        free_graph(&g);
+        free_graph(&rev);
+    }
+
+    void parseGraph() {
+        free_graph(&g);
+        free_graph(&rev);
+        open_graph(&g, filePath, undirected);
+        indexofNodes = g.indexofNodes;
+        edgeList = g.edgeList;
+    }
+
+    // Takes over the arrays of csr, e.g. a CSR built in memory instead of
+    // read from filePath; csr is left empty.
+    void adopt(Graph* csr) {
+        free_graph(&g);
+        free_graph(&rev);
+        g = *csr;
+        memset(csr, 0, sizeof(*csr));
+        indexofNodes = g.indexofNodes;
+        edgeList = g.edgeList;
+    }
+
+    // Relabels the vertices with the given ordering (graph_reorder.h) and
+    // returns the permutation, NULL for REORDER_NONE. Pointers taken before
+    // the call are invalid afterwards.
+    int* reorder(int kind, ReorderStats* stats) {
+        free_graph(&rev);
+        int* perm = reorder_graph(&g, kind, stats);
+        indexofNodes = g.indexofNodes;
+        edgeList = g.edgeList;
+        return perm;
+    }
+
+    int num_nodes() const { return g.num_nodes; }
+    long num_edges() const { return g.num_edges; }
+    int* getEdgeLen() { return g.edgeLen; }
+    Graph* csr() { return &g; }
+
+    // In-edges of every vertex, built on first use. An undirected graph is
+    // its own reverse.
+    Graph* reverse() {
+        if (undirected)
+            return &g;
+        if (rev.indexofNodes == NULL)
+            transpose_graph(&g, &rev);
+        return &rev;
+    }
+
+private:
+    graph(const graph&);
+    graph& operator=(const graph&);
+};
+
+#endif
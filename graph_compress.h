@@ -0,0 +1,219 @@
+#ifndef GRAPH_COMPRESS_H
+#define GRAPH_COMPRESS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <omp.h>
+#include "graph.h"
+
+// Byte-coded adjacency for graphs whose edge arrays, not the arithmetic on
+// them, are the bottleneck. The list of v starts with its degree as a
+// little-endian base-128 varint, then holds its weights, one, two or four
+// bytes wide as the largest weight allows, then its neighbours as the
+// differences dst - previous dst (the first one relative to v itself),
+// zigzag mapped so unsorted lists still encode, again as varints: sorted
+// lists with nearby ids take one byte per edge instead of four. Per vertex
+// only the byte offset of its list is kept, 8 bytes against the 16 of
+// separate edge and byte offsets.
+//
+//   CgEdgeIter it;
+//   int v, w;
+//   for (cg_edges(cg, u, &it); cg_next(cg, &it, &v, &w); )
+//       ...
+//
+// Edges come out in CSR order, so kernels can swap the Graph loop for the
+// iterator without other changes. There is no random access within a list.
+// cg_next looks at the weight width on every edge; hot loops call
+// cg_next_width with a constant width instead, from a body inlined once per
+// width (see dijkstra_compressed).
+
+typedef struct {
+    int num_nodes;
+    long num_edges;
+    long* byte_offset;      // first byte of each vertex's list in data
+    unsigned char* data;
+    int weight_bytes;
+} CompressedGraph;
+
+typedef struct {
+    const unsigned char* p;     // next neighbour difference
+    const unsigned char* w;     // next weight
+    long left;
+    int dst;
+} CgEdgeIter;
+
+static inline unsigned cg_zigzag(int delta) {
+    return ((unsigned)delta << 1) ^ (unsigned)(delta >> 31);
+}
+
+static inline int cg_unzigzag(unsigned x) {
+    return (int)(x >> 1) ^ -(int)(x & 1);
+}
+
+static inline int cg_varint_size(unsigned x) {
+    int bytes = 1;
+    while (x >= 0x80) {
+        x >>= 7;
+        bytes++;
+    }
+    return bytes;
+}
+
+static inline unsigned char* cg_write_varint(unsigned char* p, unsigned x) {
+    while (x >= 0x80) {
+        *p++ = (unsigned char)(x | 0x80);
+        x >>= 7;
+    }
+    *p++ = (unsigned char)x;
+    return p;
+}
+
+// One-byte values, the common case on sorted lists, take the first branch.
+static inline unsigned cg_read_varint(const unsigned char** p) {
+    const unsigned char* q = *p;
+    unsigned x = *q++;
+    if (x >= 0x80) {
+        x &= 0x7f;
+        int shift = 7;
+        unsigned b;
+        do {
+            b = *q++;
+            x |= (b & 0x7f) << shift;
+            shift += 7;
+        } while (b >= 0x80);
+    }
+    *p = q;
+    return x;
+}
+
+// Weights are packed without alignment, hence the memcpy loads.
+static inline int cg_load_weight(const unsigned char* w, int weight_bytes) {
+    switch (weight_bytes) {
+    case 1:
+        return *w;
+    case 2: {
+        uint16_t x;
+        memcpy(&x, w, sizeof(x));
+        return x;
+    }
+    default: {
+        int32_t x;
+        memcpy(&x, w, sizeof(x));
+        return x;
+    }
+    }
+}
+
+static inline void cg_store_weight(unsigned char* w, int weight, int weight_bytes) {
+    if (weight_bytes == 1) {
+        *w = (unsigned char)weight;
+    } else if (weight_bytes == 2) {
+        uint16_t x = (uint16_t)weight;
+        memcpy(w, &x, sizeof(x));
+    } else {
+        int32_t x = weight;
+        memcpy(w, &x, sizeof(x));
+    }
+}
+
+static inline void cg_edges(const CompressedGraph* cg, int v, CgEdgeIter* it) {
+    const unsigned char* p = cg->data + cg->byte_offset[v];
+    it->left = cg_read_varint(&p);
+    it->w = p;
+    it->p = p + it->left * cg->weight_bytes;
+    it->dst = v;
+}
+
+static inline __attribute__((always_inline)) bool cg_next_width(CgEdgeIter* it, int* dst, int* weight,
+                                                                int weight_bytes) {
+    if (it->left == 0)
+        return false;
+    it->left--;
+    it->dst += cg_unzigzag(cg_read_varint(&it->p));
+    *dst = it->dst;
+    *weight = cg_load_weight(it->w, weight_bytes);
+    it->w += weight_bytes;
+    return true;
+}
+
+static inline bool cg_next(const CompressedGraph* cg, CgEdgeIter* it, int* dst, int* weight) {
+    return cg_next_width(it, dst, weight, cg->weight_bytes);
+}
+
+static inline long cg_out_degree(const CompressedGraph* cg, int v) {
+    const unsigned char* p = cg->data + cg->byte_offset[v];
+    return cg_read_varint(&p);
+}
+
+// Encodes g in parallel: the weight width, per-vertex sizes, a prefix sum,
+// then every vertex writes its own range.
+static inline void compress_graph(const Graph* g, CompressedGraph* cg) {
+    int n = g->num_nodes;
+    long m = g->num_edges;
+    cg->num_nodes = n;
+    cg->num_edges = m;
+    cg->byte_offset = (long*)graph_malloc((n + 1) * sizeof(long), "byte offsets");
+
+    int min_weight = 0, max_weight = 0;
+    #pragma omp parallel for schedule(static) reduction(min:min_weight) reduction(max:max_weight)
+    for (long e = 0; e < m; e++) {
+        if (g->edgeLen[e] < min_weight)
+            min_weight = g->edgeLen[e];
+        if (g->edgeLen[e] > max_weight)
+            max_weight = g->edgeLen[e];
+    }
+    int wb = min_weight < 0 || max_weight > UINT16_MAX ? 4 : max_weight > UINT8_MAX ? 2 : 1;
+    cg->weight_bytes = wb;
+
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int v = 0; v < n; v++) {
+        long degree = out_degree(g, v);
+        long bytes = cg_varint_size((unsigned)degree) + degree * wb;
+        int prev = v;
+        for (long e = g->indexofNodes[v]; e < g->indexofNodes[v + 1]; e++) {
+            bytes += cg_varint_size(cg_zigzag(g->edgeList[e] - prev));
+            prev = g->edgeList[e];
+        }
+        cg->byte_offset[v] = bytes;
+    }
+    cg->byte_offset[n] = 0;
+    long total = prefix_sum(cg->byte_offset, n + 1);
+    cg->data = (unsigned char*)graph_malloc(total, "compressed edges");
+
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int v = 0; v < n; v++) {
+        long degree = out_degree(g, v);
+        unsigned char* w = cg_write_varint(cg->data + cg->byte_offset[v], (unsigned)degree);
+        unsigned char* p = w + degree * wb;
+        int prev = v;
+        for (long e = g->indexofNodes[v]; e < g->indexofNodes[v + 1]; e++) {
+            p = cg_write_varint(p, cg_zigzag(g->edgeList[e] - prev));
+            prev = g->edgeList[e];
+            cg_store_weight(w, g->edgeLen[e], wb);
+            w += wb;
+        }
+    }
+}
+
+static inline void free_compressed_graph(CompressedGraph* cg) {
+    free(cg->byte_offset);
+    free(cg->data);
+    cg->byte_offset = NULL;
+    cg->data = NULL;
+}
+
+// Footprint of the traversal arrays (offsets, targets, weights), without
+// node labels, which neither layout needs to run a kernel.
+static inline long csr_bytes(const Graph* g) {
+    return (g->num_nodes + 1) * (long)sizeof(long) + g->num_edges * (long)(2 * sizeof(int));
+}
+
+static inline long compressed_bytes(const CompressedGraph* cg) {
+    return (cg->num_nodes + 1) * (long)sizeof(long) + cg->byte_offset[cg->num_nodes];
+}
+
+#endif
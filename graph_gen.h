@@ -0,0 +1,376 @@
+#ifndef GRAPH_GEN_H
+#define GRAPH_GEN_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <omp.h>
+
+#include "graph.h"
+
+// Synthetic graphs for scaling runs. Every random choice is a hash of
+// (seed, stream, edge index), never a sequential generator, so the graph
+// is the same at any thread count and edges can be produced in any order.
+// Edge-list generators never hold an edge list, only the CSR graph itself
+// plus per-block scratch, which is what lets them go to billions of edges.
+// Self loops are dropped, duplicate edges are kept.
+
+typedef enum {
+    GEN_RMAT,      // R-MAT / Kronecker, 2^scale vertices, quadrant probabilities a, b, c, d
+    GEN_UNIFORM,   // Erdos-Renyi G(n, m): both endpoints uniform
+    GEN_GRID2D,    // 4-neighbour lattice, always stored in both directions
+    GEN_GRID3D     // 6-neighbour lattice, always stored in both directions
+} GenKind;
+
+typedef enum {
+    WEIGHT_UNIFORM,      // uniform in [min_weight, max_weight]
+    WEIGHT_CONSTANT,     // min_weight on every edge
+    WEIGHT_LOG_UNIFORM   // log-uniform in [max(min_weight, 1), max_weight]
+} WeightKind;
+
+typedef struct {
+    GenKind kind;
+    long num_nodes;      // GEN_UNIFORM
+    long num_edges;      // edges drawn by GEN_RMAT / GEN_UNIFORM, before dropping self loops
+    int scale;           // GEN_RMAT: 2^scale vertices
+    double a, b, c;      // GEN_RMAT quadrant probabilities, d = 1 - a - b - c
+    long dims[3];        // GEN_GRID2D / GEN_GRID3D side lengths
+    WeightKind weights;
+    int min_weight, max_weight;
+    unsigned long long seed;
+    bool undirected;     // store every drawn edge in both directions
+} GenParams;
+
+#define GEN_STREAM_EDGES 0x243f6a8885a308d3ULL
+#define GEN_STREAM_WEIGHTS 0x13198a2e03707344ULL
+
+static inline unsigned long long gen_mix(unsigned long long x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Random 64-bit value number `counter` of the given stream.
+static inline unsigned long long gen_hash(unsigned long long seed, unsigned long long stream,
+                                          unsigned long long counter) {
+    return gen_mix(gen_mix(seed ^ stream) + counter);
+}
+
+// Maps a 64-bit hash to [0, n) without modulo bias worth mentioning.
+static inline long gen_range(unsigned long long h, long n) {
+    return (long)(((unsigned __int128)h * (unsigned long long)n) >> 64);
+}
+
+// Defaults: Graph500 R-MAT skew, weights uniform in [1, 100], seed 1.
+static inline void gen_default_params(GenParams* p) {
+    memset(p, 0, sizeof(*p));
+    p->kind = GEN_UNIFORM;
+    p->scale = 16;
+    p->a = 0.57;
+    p->b = 0.19;
+    p->c = 0.19;
+    p->weights = WEIGHT_UNIFORM;
+    p->min_weight = 1;
+    p->max_weight = 100;
+    p->seed = 1;
+}
+
+static inline long gen_num_nodes(const GenParams* p) {
+    switch (p->kind) {
+    case GEN_RMAT:   return 1L << p->scale;
+    case GEN_GRID2D: return p->dims[0] * p->dims[1];
+    case GEN_GRID3D: return p->dims[0] * p->dims[1] * p->dims[2];
+    default:         return p->num_nodes;
+    }
+}
+
+static inline int gen_weight(const GenParams* p, unsigned long long key) {
+    if (p->weights == WEIGHT_CONSTANT)
+        return p->min_weight;
+    unsigned long long h = gen_hash(p->seed, GEN_STREAM_WEIGHTS, key);
+    if (p->weights == WEIGHT_LOG_UNIFORM) {
+        double lo = log(p->min_weight > 1 ? p->min_weight : 1);
+        double hi = log((double)p->max_weight + 1);
+        double u = (double)(h >> 11) * (1.0 / 9007199254740992.0);
+        int w = (int)exp(lo + u * (hi - lo));
+        return w > p->max_weight ? p->max_weight : w;
+    }
+    return p->min_weight + (int)gen_range(h, (long)p->max_weight - p->min_weight + 1);
+}
+
+// Bijection on [0, 2^scale) so R-MAT hubs are spread over the id range
+// instead of sitting at the low ids, as in Graph500.
+static inline long gen_scramble(long v, int scale) {
+    unsigned long long mask = (1ULL << scale) - 1, x = (unsigned long long)v;
+    int shift = scale > 1 ? (scale + 1) / 2 : 1;
+    x = (x * 0x9e3779b97f4a7c15ULL) & mask;
+    x ^= x >> shift;
+    x = (x * 0xd6e8feb86659fd93ULL) & mask;
+    return (long)x;
+}
+
+// Endpoints of drawn edge e for the edge-list generators.
+static inline void gen_edge(const GenParams* p, long e, int* u, int* v) {
+    if (p->kind == GEN_UNIFORM) {
+        *u = (int)gen_range(gen_hash(p->seed, GEN_STREAM_EDGES, 2 * (unsigned long long)e), p->num_nodes);
+        *v = (int)gen_range(gen_hash(p->seed, GEN_STREAM_EDGES, 2 * (unsigned long long)e + 1), p->num_nodes);
+        return;
+    }
+
+    // R-MAT: one quadrant per bit, from 16-bit slices of 64-bit draws.
+    unsigned ta = (unsigned)(p->a * 65536), tb = (unsigned)((p->a + p->b) * 65536);
+    unsigned tc = (unsigned)((p->a + p->b + p->c) * 65536);
+    unsigned long long bits = 0;
+    long src = 0, dst = 0;
+    for (int level = 0; level < p->scale; level++) {
+        if (level % 4 == 0)
+            bits = gen_hash(p->seed, GEN_STREAM_EDGES, (unsigned long long)e * 8 + level / 4);
+        unsigned r = (unsigned)(bits & 0xffff);
+        bits >>= 16;
+        src = 2 * src + (r >= tb);
+        dst = 2 * dst + ((r >= ta && r < tb) || r >= tc);
+    }
+    *u = (int)gen_scramble(src, p->scale);
+    *v = (int)gen_scramble(dst, p->scale);
+}
+
+// Lattice neighbours of v in ascending id order; returns how many.
+static inline int gen_grid_neighbors(const GenParams* p, long v, long* nbr, int* dim) {
+    long sx = p->dims[0], sy = p->dims[1];
+    long sz = p->kind == GEN_GRID3D ? p->dims[2] : 1;
+    long x = v % sx, y = v / sx % sy, z = v / (sx * sy);
+    int k = 0;
+    if (z > 0)      { nbr[k] = v - sx * sy; dim[k++] = 2; }
+    if (y > 0)      { nbr[k] = v - sx;      dim[k++] = 1; }
+    if (x > 0)      { nbr[k] = v - 1;       dim[k++] = 0; }
+    if (x + 1 < sx) { nbr[k] = v + 1;       dim[k++] = 0; }
+    if (y + 1 < sy) { nbr[k] = v + sx;      dim[k++] = 1; }
+    if (z + 1 < sz) { nbr[k] = v + sx * sy; dim[k++] = 2; }
+    return k;
+}
+
+static inline void gen_grid(Graph* g, const GenParams* p) {
+    long n = g->num_nodes;
+    #pragma omp parallel for schedule(static)
+    for (long v = 0; v < n; v++) {
+        long nbr[6];
+        int dim[6];
+        g->indexofNodes[v] = gen_grid_neighbors(p, v, nbr, dim);
+    }
+    g->indexofNodes[n] = 0;
+    g->num_edges = prefix_sum(g->indexofNodes, (int)n + 1);
+    g->edgeList = (int*)graph_malloc(g->num_edges * sizeof(int), "edge list");
+    g->edgeLen = (int*)graph_malloc(g->num_edges * sizeof(int), "edge weights");
+
+    #pragma omp parallel for schedule(static)
+    for (long v = 0; v < n; v++) {
+        long nbr[6];
+        int dim[6];
+        int k = gen_grid_neighbors(p, v, nbr, dim);
+        long pos = g->indexofNodes[v];
+        for (int i = 0; i < k; i++) {
+            // Both directions of a lattice edge share one weight.
+            long lo = nbr[i] < v ? nbr[i] : v;
+            g->edgeList[pos + i] = (int)nbr[i];
+            g->edgeLen[pos + i] = gen_weight(p, (unsigned long long)lo * 3 + dim[i]);
+        }
+    }
+}
+
+// Edge-list generators bucket edges by blocks of 2^shift source vertices
+// instead of scattering them with one atomic per edge: locked updates at
+// random addresses stall on every cache miss and were most of the build
+// time. Pass 1 counts edges per (block, chunk), pass 2 writes the packed
+// edge index (2 * e + reversed) of each edge into its block's slice of the
+// CSR arrays, and pass 3 sorts every block into CSR order locally. Edges
+// are regenerated from their index in each pass rather than stored.
+static inline void gen_edge_list(Graph* g, const GenParams* p) {
+    long n = g->num_nodes, m = p->num_edges;
+    int shift = 12;
+    while ((n >> shift) > 65536)
+        shift++;
+    long blocks = ((n - 1) >> shift) + 1;
+    int nt = omp_get_max_threads();
+    long* counts = (long*)graph_malloc((blocks * nt + 1) * sizeof(long), "generator counts");
+
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i <= blocks * nt; i++)
+        counts[i] = 0;
+
+    // The edges are split into nt fixed chunks, chunk c counting in column
+    // c, whatever size of team the runtime actually grants.
+    #pragma omp parallel for schedule(static, 1)
+    for (int c = 0; c < nt; c++) {
+        for (long e = m * c / nt; e < m * (c + 1) / nt; e++) {
+            int u, v;
+            gen_edge(p, e, &u, &v);
+            if (u == v)
+                continue;
+            counts[(u >> shift) * nt + c]++;
+            if (p->undirected)
+                counts[(v >> shift) * nt + c]++;
+        }
+    }
+
+    g->num_edges = prefix_sum(counts, (int)(blocks * nt) + 1);
+    g->edgeList = (int*)graph_malloc(g->num_edges * sizeof(int), "edge list");
+    g->edgeLen = (int*)graph_malloc(g->num_edges * sizeof(int), "edge weights");
+
+    #pragma omp parallel for schedule(static, 1)
+    for (int c = 0; c < nt; c++) {
+        for (long e = m * c / nt; e < m * (c + 1) / nt; e++) {
+            int u, v;
+            gen_edge(p, e, &u, &v);
+            if (u == v)
+                continue;
+            for (int rev = 0; rev <= (int)p->undirected; rev++) {
+                unsigned long long key = 2 * (unsigned long long)e + rev;
+                long pos = counts[((rev ? v : u) >> shift) * nt + c]++;
+                g->edgeList[pos] = (int)(unsigned)key;
+                g->edgeLen[pos] = (int)(unsigned)(key >> 32);
+            }
+        }
+    }
+
+    // counts[b * nt + nt - 1] is now the end of block b.
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (long b = 0; b < blocks; b++) {
+        long begin = b ? counts[(b - 1) * nt + nt - 1] : 0;
+        long end = counts[b * nt + nt - 1];
+        long vlo = b << shift;
+        long vhi = vlo + (1L << shift) < n ? vlo + (1L << shift) : n;
+        long len = end - begin;
+        long* offset = (long*)graph_malloc((vhi - vlo + 1) * sizeof(long), "block offsets");
+        int* src = (int*)graph_malloc(len * sizeof(int), "block edges");
+        int* dst = (int*)graph_malloc(len * sizeof(int), "block edges");
+        int* w = (int*)graph_malloc(len * sizeof(int), "block edges");
+
+        for (long v = 0; v <= vhi - vlo; v++)
+            offset[v] = 0;
+        for (long i = 0; i < len; i++) {
+            unsigned long long key = (unsigned)g->edgeList[begin + i] |
+                                     ((unsigned long long)(unsigned)g->edgeLen[begin + i] << 32);
+            long e = (long)(key >> 1);
+            int u, v;
+            gen_edge(p, e, &u, &v);
+            src[i] = key & 1 ? v : u;
+            dst[i] = key & 1 ? u : v;
+            w[i] = gen_weight(p, (unsigned long long)e);
+            offset[src[i] - vlo + 1]++;
+        }
+        for (long v = 0; v < vhi - vlo; v++) {
+            offset[v + 1] += offset[v];
+            g->indexofNodes[vlo + v] = begin + offset[v];
+        }
+        for (long i = 0; i < len; i++) {
+            long pos = begin + offset[src[i] - vlo]++;
+            g->edgeList[pos] = dst[i];
+            g->edgeLen[pos] = w[i];
+        }
+        // Generation order within a vertex depends on the thread count;
+        // sorting restores one canonical layout.
+        for (long v = vlo; v < vhi; v++) {
+            long first = g->indexofNodes[v];
+            long last = v + 1 < vhi ? g->indexofNodes[v + 1] : end;
+            sort_neighbors(g->edgeList + first, g->edgeLen + first, last - first);
+        }
+
+        free(offset);
+        free(src);
+        free(dst);
+        free(w);
+    }
+    g->indexofNodes[n] = g->num_edges;
+    free(counts);
+}
+
+// Builds the graph described by p into g.
+static inline void generate_graph(Graph* g, const GenParams* p) {
+    long n = gen_num_nodes(p);
+    if (n <= 0 || n >= 2147483647L || p->min_weight > p->max_weight ||
+        (p->kind == GEN_RMAT && (p->scale < 1 || p->scale > 30 || p->a + p->b + p->c > 1.0)) ||
+        ((p->kind == GEN_RMAT || p->kind == GEN_UNIFORM) && p->num_edges < 0)) {
+        fprintf(stderr, "Error: Invalid generator parameters\n");
+        exit(EXIT_FAILURE);
+    }
+
+    g->num_nodes = (int)n;
+    g->nodeLabel = NULL;
+    g->mapping = NULL;
+    g->mapping_size = 0;
+    g->indexofNodes = (long*)graph_malloc((n + 1) * sizeof(long), "graph offsets");
+
+    if (p->kind == GEN_GRID2D || p->kind == GEN_GRID3D)
+        gen_grid(g, p);
+    else
+        gen_edge_list(g, p);
+}
+
+// Parses a generator description:
+//   rmat:SCALE:EDGE_FACTOR[:A:B:C]   uniform:NODES:EDGES
+//   grid2d:X:Y                       grid3d:X:Y:Z
+// followed by optional comma-separated settings:
+//   weights=uniform:LO:HI | weights=constant:W | weights=log:LO:HI
+//   seed=N   undirected
+// e.g. "rmat:20:16:0.57:0.19:0.19,weights=log:1:1000000,seed=7".
+// Fields not given keep the values already in p. Returns false when spec
+// does not name a generator.
+static inline bool parse_gen_spec(const char* spec, GenParams* p) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", spec);
+    char* rest = strchr(buf, ',');
+    if (rest)
+        *rest++ = '\0';
+
+    double x[5] = {0, 0, 0, 0, 0};
+    char kind[16] = "";
+    int got = sscanf(buf, "%15[a-z0-9]:%lf:%lf:%lf:%lf:%lf", kind, &x[0], &x[1], &x[2], &x[3], &x[4]) - 1;
+    if (strcmp(kind, "rmat") == 0 && (got == 2 || got == 5)) {
+        p->kind = GEN_RMAT;
+        p->scale = (int)x[0];
+        p->num_edges = (long)(x[1] * ((double)(1L << p->scale)));
+        if (got == 5) {
+            p->a = x[2];
+            p->b = x[3];
+            p->c = x[4];
+        }
+    } else if (strcmp(kind, "uniform") == 0 && got == 2) {
+        p->kind = GEN_UNIFORM;
+        p->num_nodes = (long)x[0];
+        p->num_edges = (long)x[1];
+    } else if (strcmp(kind, "grid2d") == 0 && got == 2) {
+        p->kind = GEN_GRID2D;
+        p->dims[0] = (long)x[0];
+        p->dims[1] = (long)x[1];
+    } else if (strcmp(kind, "grid3d") == 0 && got == 3) {
+        p->kind = GEN_GRID3D;
+        p->dims[0] = (long)x[0];
+        p->dims[1] = (long)x[1];
+        p->dims[2] = (long)x[2];
+    } else {
+        return false;
+    }
+
+    for (char* opt = rest ? strtok(rest, ",") : NULL; opt; opt = strtok(NULL, ",")) {
+        if (sscanf(opt, "weights=uniform:%d:%d", &p->min_weight, &p->max_weight) == 2) {
+            p->weights = WEIGHT_UNIFORM;
+        } else if (sscanf(opt, "weights=constant:%d", &p->min_weight) == 1) {
+            p->weights = WEIGHT_CONSTANT;
+            p->max_weight = p->min_weight;
+        } else if (sscanf(opt, "weights=log:%d:%d", &p->min_weight, &p->max_weight) == 2) {
+            p->weights = WEIGHT_LOG_UNIFORM;
+        } else if (sscanf(opt, "seed=%llu", &p->seed) == 1) {
+        } else if (strcmp(opt, "undirected") == 0) {
+            p->undirected = true;
+        } else {
+            fprintf(stderr, "Error: Unknown generator option %s\n", opt);
+            exit(EXIT_FAILURE);
+        }
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,434 @@
+#ifndef GRAPH_REORDER_H
+#define GRAPH_REORDER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "graph.h"
+
+// Vertex relabelling for cache locality. Input graphs come with arbitrary
+// ids, so dist[v] and visited[v] in the relax loops hit memory at random;
+// an ordering that gives neighbours nearby ids turns many of those misses
+// into hits. perm[old id] = new id throughout.
+//
+//   degree  all vertices by decreasing degree
+//   hub     vertices above the average degree first, both groups in their
+//           original order (hub clustering; keeps the input's own locality)
+//   rcm     reverse Cuthill-McKee: BFS from a low-degree vertex of every
+//           component, neighbours in increasing degree, reversed
+//   gorder  greedy window ordering after Gorder: the next vertex is the one
+//           sharing the most edges and in-neighbours with the last
+//           GORDER_WINDOW placed
+//
+// Degrees count in- and out-edges; rcm and gorder treat edges as
+// undirected.
+
+#define REORDER_NONE 0
+#define REORDER_DEGREE 1
+#define REORDER_HUB 2
+#define REORDER_RCM 3
+#define REORDER_GORDER 4
+
+#define GORDER_WINDOW 5
+// In-neighbours with more out-edges than this are not used to find
+// siblings: a hub would make all of its out-neighbours siblings of each
+// other at quadratic cost while saying little about locality.
+#define GORDER_SIBLING_DEGREE 32
+
+typedef struct {
+    int kind;
+    double order_time;   // computing the permutation
+    double build_time;   // building the permuted CSR
+    double gap_before;   // mean log2(|u - v| + 1) over the edges
+    double gap_after;
+} ReorderStats;
+
+static inline const char* reorder_name(int kind) {
+    static const char* names[] = { "none", "degree", "hub", "rcm", "gorder" };
+    return names[kind];
+}
+
+static inline int parse_reorder(const char* name) {
+    for (int k = REORDER_NONE; k <= REORDER_GORDER; k++)
+        if (strcmp(name, reorder_name(k)) == 0)
+            return k;
+    fprintf(stderr, "Error: Unknown ordering %s (expected none, degree, hub, rcm or gorder)\n", name);
+    exit(EXIT_FAILURE);
+}
+
+// Mean log2 of the id distance across an edge: lower means neighbours sit
+// closer together in dist[] and friends.
+static inline double edge_gap_log2(const Graph* g) {
+    double sum = 0;
+    #pragma omp parallel for schedule(dynamic, 1024) reduction(+:sum)
+    for (int u = 0; u < g->num_nodes; u++)
+        for (long e = g->indexofNodes[u]; e < g->indexofNodes[u + 1]; e++)
+            sum += log2(fabs((double)g->edgeList[e] - u) + 1);
+    return g->num_edges ? sum / g->num_edges : 0;
+}
+
+// In- plus out-degree of every vertex.
+static inline long* total_degrees(const Graph* g) {
+    int n = g->num_nodes;
+    long* deg = (long*)graph_malloc((n ? n : 1) * sizeof(long), "degrees");
+    #pragma omp parallel for schedule(static)
+    for (int v = 0; v < n; v++)
+        deg[v] = out_degree(g, v);
+    #pragma omp parallel for schedule(static)
+    for (long e = 0; e < g->num_edges; e++) {
+        #pragma omp atomic
+        deg[g->edgeList[e]]++;
+    }
+    return deg;
+}
+
+// Sorts packed keys; short runs by insertion, long ones by radix sort.
+static inline void sort_keys(unsigned long long* keys, unsigned long long* tmp, long len) {
+    if (len > 32) {
+        radix_sort_u64(keys, tmp, len);
+        return;
+    }
+    for (long i = 1; i < len; i++) {
+        unsigned long long x = keys[i];
+        long j = i - 1;
+        while (j >= 0 && keys[j] > x) {
+            keys[j + 1] = keys[j];
+            j--;
+        }
+        keys[j + 1] = x;
+    }
+}
+
+// Vertices ordered by (degree, id), ascending or descending in degree.
+static inline int* vertices_by_degree(const long* deg, int n, bool descending) {
+    long max_deg = 0;
+    for (int v = 0; v < n; v++)
+        if (deg[v] > max_deg)
+            max_deg = deg[v];
+    unsigned long long* keys = (unsigned long long*)graph_malloc(2 * (n ? n : 1) * sizeof(unsigned long long), "degree sort");
+    #pragma omp parallel for schedule(static)
+    for (int v = 0; v < n; v++)
+        keys[v] = ((unsigned long long)(descending ? max_deg - deg[v] : deg[v]) << 32) | (unsigned)v;
+    radix_sort_u64(keys, keys + n, n);
+    int* order = (int*)graph_malloc((n ? n : 1) * sizeof(int), "vertex order");
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++)
+        order[i] = (int)(unsigned)keys[i];
+    free(keys);
+    return order;
+}
+
+static inline void order_degree(const Graph* g, int* perm) {
+    int n = g->num_nodes;
+    long* deg = total_degrees(g);
+    int* order = vertices_by_degree(deg, n, true);
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++)
+        perm[order[i]] = i;
+    free(order);
+    free(deg);
+}
+
+static inline void order_hub(const Graph* g, int* perm) {
+    int n = g->num_nodes;
+    long* deg = total_degrees(g);
+    long* rank = (long*)graph_malloc((n + 1) * sizeof(long), "hub ranks");
+    double average = n ? 2.0 * g->num_edges / n : 0;
+    #pragma omp parallel for schedule(static)
+    for (int v = 0; v < n; v++)
+        rank[v] = deg[v] > average;
+    rank[n] = 0;
+    long hubs = prefix_sum(rank, n + 1);
+    #pragma omp parallel for schedule(static)
+    for (int v = 0; v < n; v++)
+        perm[v] = (int)(deg[v] > average ? rank[v] : hubs + v - rank[v]);
+    free(rank);
+    free(deg);
+}
+
+static inline void order_rcm(const Graph* g, int* perm) {
+    int n = g->num_nodes;
+    Graph t;
+    transpose_graph(g, &t);
+    long* deg = total_degrees(g);
+    int* starts = vertices_by_degree(deg, n, false);
+    int* queue = (int*)graph_malloc((n ? n : 1) * sizeof(int), "BFS queue");
+    bool* seen = (bool*)graph_malloc((n ? n : 1) * sizeof(bool), "BFS flags");
+    long max_deg = 0;
+    for (int v = 0; v < n; v++) {
+        seen[v] = false;
+        if (deg[v] > max_deg)
+            max_deg = deg[v];
+    }
+    unsigned long long* keys = (unsigned long long*)graph_malloc(2 * (max_deg + 1) * sizeof(unsigned long long), "neighbour sort");
+
+    long tail = 0;
+    for (int s = 0; s < n; s++) {
+        if (seen[starts[s]])
+            continue;
+        long head = tail;
+        queue[tail++] = starts[s];
+        seen[starts[s]] = true;
+        while (head < tail) {
+            int u = queue[head++];
+            long k = 0;
+            for (int side = 0; side < 2; side++) {
+                const Graph* adj = side ? &t : g;
+                for (long e = adj->indexofNodes[u]; e < adj->indexofNodes[u + 1]; e++) {
+                    int v = adj->edgeList[e];
+                    if (!seen[v]) {
+                        seen[v] = true;
+                        keys[k++] = ((unsigned long long)deg[v] << 32) | (unsigned)v;
+                    }
+                }
+            }
+            sort_keys(keys, keys + k, k);
+            for (long i = 0; i < k; i++)
+                queue[tail++] = (int)(unsigned)keys[i];
+        }
+    }
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++)
+        perm[queue[i]] = n - 1 - i;
+
+    free(keys);
+    free(seen);
+    free(queue);
+    free(starts);
+    free(deg);
+    free_graph(&t);
+}
+
+// Bucket queue of the unplaced vertices by score ("unit heap"): scores only
+// ever move by one, so a vertex moves between neighbouring doubly linked
+// lists in O(1) and the maximum is found by walking top down.
+typedef struct {
+    int* key;
+    int* prev;
+    int* next;
+    int* head;
+    int num_keys;
+    int top;
+} GorderQueue;
+
+static inline void gorder_unlink(GorderQueue* q, int v) {
+    if (q->prev[v] >= 0)
+        q->next[q->prev[v]] = q->next[v];
+    else
+        q->head[q->key[v]] = q->next[v];
+    if (q->next[v] >= 0)
+        q->prev[q->next[v]] = q->prev[v];
+}
+
+static inline void gorder_link(GorderQueue* q, int v) {
+    int k = q->key[v];
+    if (k >= q->num_keys) {
+        int grown = 2 * k + 16;
+        q->head = (int*)realloc(q->head, grown * sizeof(int));
+        if (q->head == NULL) {
+            fprintf(stderr, "Error: Could not allocate memory for ordering queue\n");
+            exit(EXIT_FAILURE);
+        }
+        for (int i = q->num_keys; i < grown; i++)
+            q->head[i] = -1;
+        q->num_keys = grown;
+    }
+    q->prev[v] = -1;
+    q->next[v] = q->head[k];
+    if (q->head[k] >= 0)
+        q->prev[q->head[k]] = v;
+    q->head[k] = v;
+    if (k > q->top)
+        q->top = k;
+}
+
+// Adds delta to the score of every unplaced vertex related to v: its in-
+// and out-neighbours, and the out-neighbours of its low-degree in-neighbours.
+static inline void gorder_touch(const Graph* g, const Graph* t, GorderQueue* q, const bool* placed,
+                                int v, int delta) {
+    for (int side = 0; side < 2; side++) {
+        const Graph* adj = side ? t : g;
+        for (long e = adj->indexofNodes[v]; e < adj->indexofNodes[v + 1]; e++) {
+            int x = adj->edgeList[e];
+            if (!placed[x]) {
+                gorder_unlink(q, x);
+                q->key[x] += delta;
+                gorder_link(q, x);
+            }
+        }
+    }
+    for (long e = t->indexofNodes[v]; e < t->indexofNodes[v + 1]; e++) {
+        int z = t->edgeList[e];
+        if (out_degree(g, z) > GORDER_SIBLING_DEGREE)
+            continue;
+        for (long f = g->indexofNodes[z]; f < g->indexofNodes[z + 1]; f++) {
+            int x = g->edgeList[f];
+            if (!placed[x] && x != v) {
+                gorder_unlink(q, x);
+                q->key[x] += delta;
+                gorder_link(q, x);
+            }
+        }
+    }
+}
+
+static inline void order_gorder(const Graph* g, int* perm) {
+    int n = g->num_nodes;
+    Graph t;
+    transpose_graph(g, &t);
+    long* deg = total_degrees(g);
+    // When nothing unplaced relates to the window, continue with the
+    // highest-degree vertex left.
+    int* fallback = vertices_by_degree(deg, n, true);
+    int* order = (int*)graph_malloc((n ? n : 1) * sizeof(int), "vertex order");
+    bool* placed = (bool*)graph_malloc((n ? n : 1) * sizeof(bool), "placed flags");
+    GorderQueue q;
+    q.key = (int*)graph_malloc((n ? n : 1) * sizeof(int), "ordering scores");
+    q.prev = (int*)graph_malloc((n ? n : 1) * sizeof(int), "ordering queue");
+    q.next = (int*)graph_malloc((n ? n : 1) * sizeof(int), "ordering queue");
+    q.head = NULL;
+    q.num_keys = 0;
+    q.top = 0;
+    for (int v = n - 1; v >= 0; v--) {
+        placed[v] = false;
+        q.key[v] = 0;
+        gorder_link(&q, v);
+    }
+
+    int cursor = 0;
+    for (int i = 0; i < n; i++) {
+        while (q.top > 0 && q.head[q.top] < 0)
+            q.top--;
+        int v;
+        if (q.top > 0) {
+            v = q.head[q.top];
+        } else {
+            while (placed[fallback[cursor]])
+                cursor++;
+            v = fallback[cursor];
+        }
+        gorder_unlink(&q, v);
+        placed[v] = true;
+        order[i] = v;
+        perm[v] = i;
+        gorder_touch(g, &t, &q, placed, v, 1);
+        if (i >= GORDER_WINDOW)
+            gorder_touch(g, &t, &q, placed, order[i - GORDER_WINDOW], -1);
+    }
+
+    free(q.key);
+    free(q.prev);
+    free(q.next);
+    free(q.head);
+    free(placed);
+    free(order);
+    free(fallback);
+    free(deg);
+    free_graph(&t);
+}
+
+static inline void reorder_permutation(const Graph* g, int kind, int* perm) {
+    switch (kind) {
+    case REORDER_DEGREE: order_degree(g, perm); break;
+    case REORDER_HUB:    order_hub(g, perm); break;
+    case REORDER_RCM:    order_rcm(g, perm); break;
+    case REORDER_GORDER: order_gorder(g, perm); break;
+    default:
+        #pragma omp parallel for schedule(static)
+        for (int v = 0; v < g->num_nodes; v++)
+            perm[v] = v;
+    }
+}
+
+// Builds the relabelled CSR in parallel: vertex perm[v] of out gets the
+// edges of v with their endpoints relabelled, neighbour lists re-sorted.
+// Input ids in nodeLabel move with their vertices.
+static inline void permute_graph(const Graph* g, const int* perm, Graph* out) {
+    int n = g->num_nodes;
+    int* inverse = (int*)graph_malloc((n ? n : 1) * sizeof(int), "inverse permutation");
+    #pragma omp parallel for schedule(static)
+    for (int v = 0; v < n; v++)
+        inverse[perm[v]] = v;
+
+    out->num_nodes = n;
+    out->mapping = NULL;
+    out->mapping_size = 0;
+    out->indexofNodes = (long*)graph_malloc((n + 1) * sizeof(long), "graph offsets");
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++)
+        out->indexofNodes[i] = out_degree(g, inverse[i]);
+    out->indexofNodes[n] = 0;
+    out->num_edges = prefix_sum(out->indexofNodes, n + 1);
+    out->edgeList = (int*)graph_malloc(out->num_edges * sizeof(int), "edge list");
+    out->edgeLen = (int*)graph_malloc(out->num_edges * sizeof(int), "edge weights");
+
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int i = 0; i < n; i++) {
+        int v = inverse[i];
+        long to = out->indexofNodes[i];
+        for (long e = g->indexofNodes[v]; e < g->indexofNodes[v + 1]; e++, to++) {
+            out->edgeList[to] = perm[g->edgeList[e]];
+            out->edgeLen[to] = g->edgeLen[e];
+        }
+        sort_neighbors(out->edgeList + out->indexofNodes[i], out->edgeLen + out->indexofNodes[i],
+                       out_degree(g, v));
+    }
+
+    out->nodeLabel = NULL;
+    if (g->nodeLabel != NULL) {
+        out->nodeLabel = (long long*)graph_malloc(n * sizeof(long long), "node labels");
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < n; i++)
+            out->nodeLabel[i] = g->nodeLabel[inverse[i]];
+    }
+    free(inverse);
+}
+
+// Relabels *g in place with the given ordering and returns the permutation
+// (perm[old id] = new id, free it when done), or NULL for REORDER_NONE.
+// Results computed on the new graph map back with perm: the value for
+// original vertex v is at index perm[v].
+static inline int* reorder_graph(Graph* g, int kind, ReorderStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->kind = kind;
+    if (kind == REORDER_NONE)
+        return NULL;
+    stats->gap_before = edge_gap_log2(g);
+
+    int* perm = (int*)graph_malloc((g->num_nodes ? g->num_nodes : 1) * sizeof(int), "permutation");
+    double start_time = omp_get_wtime();
+    reorder_permutation(g, kind, perm);
+    stats->order_time = omp_get_wtime() - start_time;
+
+    Graph out;
+    start_time = omp_get_wtime();
+    permute_graph(g, perm, &out);
+    stats->build_time = omp_get_wtime() - start_time;
+
+    free_graph(g);
+    *g = out;
+    stats->gap_after = edge_gap_log2(g);
+    return perm;
+}
+
+// New id of original vertex v; perm may be NULL (no reordering).
+static inline int reorder_id(const int* perm, int v) {
+    return perm ? perm[v] : v;
+}
+
+// Prints what the reordering cost and what it bought one kernel run.
+static inline void reorder_report(const ReorderStats* stats, const char* kernel, double before, double after) {
+    double cost = stats->order_time + stats->build_time;
+    printf("Reorder %s: ordering %.4f s, CSR build %.4f s, mean log2 edge gap %.2f -> %.2f\n",
+           reorder_name(stats->kind), stats->order_time, stats->build_time, stats->gap_before,
+           stats->gap_after);
+    printf("  %s (in sec): %.4f -> %.4f, speedup %.2fx", kernel, before, after, before / after);
+    if (after < before)
+        printf(", pays for itself after %.0f runs\n", ceil(cost / (before - after)));
+    else
+        printf(", never pays for itself\n");
+}
+
+#endif
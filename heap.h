@@ -0,0 +1,21 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <stdbool.h>
+
+// Indexed d-ary min-heap over vertex ids 0..capacity-1. pos[v] is the slot
+// of v in nodes (or -1), which makes decrease-key O(log_d n) instead of a
+// linear search. The arity must be 2, 4 or 8 so parent/child indices are
+// shifts. The int-keyed heap is HeapEntry / IndexedHeap / heap_*; the other
+// distance types get their own copies from heap_impl.h, suffixed by type
+// (IndexedHeap_u16, heap_pop_u16, ...), see dijkstra_kernel.h.
+#define HEAP_KEY int
+#define HEAP_FN(name) name
+#include "heap_impl.h"
+#undef HEAP_KEY
+#undef HEAP_FN
+
+#endif
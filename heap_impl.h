@@ -0,0 +1,123 @@
+// Indexed d-ary min-heap for one key type. Included by heap.h for int keys
+// and by dijkstra_kernel.h once per distance type, with HEAP_KEY (key type)
+// and HEAP_FN(name) (name mangling of the types and functions) defined;
+// there is deliberately no include guard.
+
+#if !defined(HEAP_KEY) || !defined(HEAP_FN)
+#error "define HEAP_KEY and HEAP_FN before including heap_impl.h"
+#endif
+
+typedef struct {
+    int node;
+    HEAP_KEY dist;
+} HEAP_FN(HeapEntry);
+
+typedef struct {
+    HEAP_FN(HeapEntry)* nodes;
+    int* pos;
+    int size;
+    int capacity;
+    int shift;   // log2 of the arity
+} HEAP_FN(IndexedHeap);
+
+static inline HEAP_FN(IndexedHeap)* HEAP_FN(heap_create)(int capacity, int arity) {
+    HEAP_FN(IndexedHeap)* heap = (HEAP_FN(IndexedHeap)*)malloc(sizeof(HEAP_FN(IndexedHeap)));
+    if (heap == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for heap\n");
+        exit(EXIT_FAILURE);
+    }
+    if (arity != 2 && arity != 4 && arity != 8) {
+        fprintf(stderr, "Error: Heap arity must be 2, 4 or 8 (got %d)\n", arity);
+        exit(EXIT_FAILURE);
+    }
+    heap->shift = arity == 2 ? 1 : arity == 4 ? 2 : 3;
+    heap->capacity = capacity;
+    heap->size = 0;
+    heap->nodes = (HEAP_FN(HeapEntry)*)malloc((capacity ? capacity : 1) * sizeof(HEAP_FN(HeapEntry)));
+    heap->pos = (int*)malloc((capacity ? capacity : 1) * sizeof(int));
+    if (heap->nodes == NULL || heap->pos == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for heap of %d nodes\n", capacity);
+        exit(EXIT_FAILURE);
+    }
+    for (int v = 0; v < capacity; v++)
+        heap->pos[v] = -1;
+    return heap;
+}
+
+static inline void HEAP_FN(heap_free)(HEAP_FN(IndexedHeap)* heap) {
+    free(heap->nodes);
+    free(heap->pos);
+    free(heap);
+}
+
+// Empties the heap in O(size) so it can be reused for another source.
+static inline void HEAP_FN(heap_clear)(HEAP_FN(IndexedHeap)* heap) {
+    for (int i = 0; i < heap->size; i++)
+        heap->pos[heap->nodes[i].node] = -1;
+    heap->size = 0;
+}
+
+static inline bool HEAP_FN(heap_empty)(const HEAP_FN(IndexedHeap)* heap) {
+    return heap->size == 0;
+}
+
+static inline bool HEAP_FN(heap_contains)(const HEAP_FN(IndexedHeap)* heap, int node) {
+    return heap->pos[node] >= 0;
+}
+
+static inline void HEAP_FN(heap_sift_up)(HEAP_FN(IndexedHeap)* heap, int i, HEAP_FN(HeapEntry) x) {
+    while (i > 0) {
+        int parent = (i - 1) >> heap->shift;
+        if (heap->nodes[parent].dist <= x.dist)
+            break;
+        heap->nodes[i] = heap->nodes[parent];
+        heap->pos[heap->nodes[i].node] = i;
+        i = parent;
+    }
+    heap->nodes[i] = x;
+    heap->pos[x.node] = i;
+}
+
+static inline void HEAP_FN(heap_sift_down)(HEAP_FN(IndexedHeap)* heap, int i, HEAP_FN(HeapEntry) x) {
+    int arity = 1 << heap->shift;
+    for (;;) {
+        int first = (i << heap->shift) + 1;
+        if (first >= heap->size)
+            break;
+        int last = first + arity < heap->size ? first + arity : heap->size;
+        int best = first;
+        for (int c = first + 1; c < last; c++)
+            if (heap->nodes[c].dist < heap->nodes[best].dist)
+                best = c;
+        if (heap->nodes[best].dist >= x.dist)
+            break;
+        heap->nodes[i] = heap->nodes[best];
+        heap->pos[heap->nodes[i].node] = i;
+        i = best;
+    }
+    heap->nodes[i] = x;
+    heap->pos[x.node] = i;
+}
+
+// Inserts node with the given distance, or lowers its key if it is already
+// queued. A larger distance for a queued node is ignored.
+static inline void HEAP_FN(heap_push_or_decrease)(HEAP_FN(IndexedHeap)* heap, int node, HEAP_KEY dist) {
+    HEAP_FN(HeapEntry) x;
+    x.node = node;
+    x.dist = dist;
+    int i = heap->pos[node];
+    if (i < 0) {
+        HEAP_FN(heap_sift_up)(heap, heap->size++, x);
+    } else if (dist < heap->nodes[i].dist) {
+        HEAP_FN(heap_sift_up)(heap, i, x);
+    }
+}
+
+static inline HEAP_FN(HeapEntry) HEAP_FN(heap_pop)(HEAP_FN(IndexedHeap)* heap) {
+    HEAP_FN(HeapEntry) root = heap->nodes[0];
+    heap->pos[root.node] = -1;
+    heap->size--;
+    if (heap->size > 0)
+        HEAP_FN(heap_sift_down)(heap, 0, heap->nodes[heap->size]);
+    return root;
+}
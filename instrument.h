@@ -0,0 +1,284 @@
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+// Per-phase instrumentation for the SSSP kernels, compiled in with
+// -DINSTRUMENT and compiled out (every macro expands to nothing) otherwise.
+//
+//   INSTR_BEGIN(phase) / INSTR_END(phase)   time a phase on the calling thread
+//   INSTR_COUNT(counter, n)                 add n to a per-thread counter
+//   instr_reset()                           clear everything before a run
+//   instr_report(kernel)                    print the breakdown; with
+//                                           INSTRUMENT_JSON=path in the
+//                                           environment, also append it there
+//                                           as one JSON line
+//
+// Every thread has its own cache-line aligned slot, so probes never share
+// a line. Timers read the TSC (clock_gettime elsewhere). Phases may nest
+// as long as they are different phases.
+//
+// With -DINSTRUMENT_PERF each thread also opens a perf_event_open group
+// for cycles, instructions, LLC misses and branch misses on first use and
+// reads it at every INSTR_BEGIN/INSTR_END. A read is a system call, so
+// keep perf builds for phases that are not per-edge. If the kernel does
+// not allow the events (perf_event_paranoid, VMs) the columns show n/a.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <omp.h>
+
+enum {
+    PHASE_EXTRACT_MIN,   // heap pop or argmin selection
+    PHASE_RELAX,         // relaxing out-edges
+    PHASE_LOCK_WAIT,     // waiting to enter critical sections
+    PHASE_FRONTIER,      // bucket / worklist management, modified-flag swaps
+    PHASE_BARRIER,       // waiting for the rest of the team
+    INSTR_PHASES
+};
+
+enum {
+    COUNT_RELAXATIONS,   // edges examined
+    COUNT_UPDATES,       // distances lowered
+    COUNT_HEAP_OPS,      // pushes, decrease-keys and pops
+    COUNT_LOCKS,         // critical sections entered
+    INSTR_COUNTERS
+};
+
+#ifdef INSTRUMENT
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define instr_ticks() ((unsigned long long)__rdtsc())
+#else
+static inline unsigned long long instr_ticks(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#endif
+
+#ifdef INSTRUMENT_PERF
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#define INSTR_EVENTS 4
+#endif
+
+#define INSTR_MAX_THREADS 256
+
+static const char* instr_phase_names[INSTR_PHASES] = {
+    "extract_min", "relax", "lock_wait", "frontier", "barrier"
+};
+static const char* instr_counter_names[INSTR_COUNTERS] = {
+    "relaxations", "updates", "heap_ops", "locks"
+};
+
+typedef struct {
+    unsigned long long start[INSTR_PHASES];
+    unsigned long long ticks[INSTR_PHASES];
+    long calls[INSTR_PHASES];
+    long counts[INSTR_COUNTERS];
+#ifdef INSTRUMENT_PERF
+    int perf_fd;         // group leader, -1 when unavailable, 0 before first use
+    unsigned long long perf_start[INSTR_PHASES][INSTR_EVENTS];
+    unsigned long long perf[INSTR_PHASES][INSTR_EVENTS];
+#endif
+} __attribute__((aligned(64))) InstrThread;
+
+static InstrThread instr_threads[INSTR_MAX_THREADS];
+static unsigned long long instr_tick0;
+static double instr_wall0;
+
+static inline InstrThread* instr_self(void) {
+    int tid = omp_get_thread_num();
+    return &instr_threads[tid < INSTR_MAX_THREADS ? tid : INSTR_MAX_THREADS - 1];
+}
+
+#ifdef INSTRUMENT_PERF
+static inline int instr_perf_open(unsigned long long config, int group) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+// Reads the calling thread's counter group into values; opens it first if
+// needed. Returns 0 when the counters are unavailable.
+static inline int instr_perf_read(InstrThread* t, unsigned long long* values) {
+    if (t->perf_fd == 0) {
+        static const unsigned long long events[INSTR_EVENTS] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+        };
+        // The members stay open with the leader; if one fails, every fd
+        // opened so far is closed and the thread goes without counters.
+        int fds[INSTR_EVENTS];
+        int opened = 0;
+        while (opened < INSTR_EVENTS &&
+               (fds[opened] = instr_perf_open(events[opened], opened ? fds[0] : -1)) >= 0)
+            opened++;
+        if (opened < INSTR_EVENTS)
+            while (opened > 0)
+                close(fds[--opened]);
+        t->perf_fd = opened ? fds[0] : -1;
+    }
+    if (t->perf_fd < 0)
+        return 0;
+    unsigned long long buf[1 + INSTR_EVENTS];
+    if (read(t->perf_fd, buf, sizeof(buf)) != (ssize_t)sizeof(buf))
+        return 0;
+    memcpy(values, buf + 1, sizeof(unsigned long long) * INSTR_EVENTS);
+    return 1;
+}
+#endif
+
+static inline void instr_begin(int phase) {
+    InstrThread* t = instr_self();
+#ifdef INSTRUMENT_PERF
+    instr_perf_read(t, t->perf_start[phase]);
+#endif
+    t->start[phase] = instr_ticks();
+}
+
+static inline void instr_end(int phase) {
+    InstrThread* t = instr_self();
+    t->ticks[phase] += instr_ticks() - t->start[phase];
+    t->calls[phase]++;
+#ifdef INSTRUMENT_PERF
+    unsigned long long now[INSTR_EVENTS];
+    if (instr_perf_read(t, now))
+        for (int e = 0; e < INSTR_EVENTS; e++)
+            t->perf[phase][e] += now[e] - t->perf_start[phase][e];
+#endif
+}
+
+#define INSTR_ENABLED 1
+#define INSTR_BEGIN(phase) instr_begin(phase)
+#define INSTR_END(phase) instr_end(phase)
+#define INSTR_COUNT(counter, n) (instr_self()->counts[counter] += (n))
+
+static inline void instr_reset(void) {
+    for (int i = 0; i < INSTR_MAX_THREADS; i++) {
+        InstrThread* t = &instr_threads[i];
+        memset(t->ticks, 0, sizeof(t->ticks));
+        memset(t->calls, 0, sizeof(t->calls));
+        memset(t->counts, 0, sizeof(t->counts));
+#ifdef INSTRUMENT_PERF
+        memset(t->perf, 0, sizeof(t->perf));
+#endif
+    }
+    instr_wall0 = omp_get_wtime();
+    instr_tick0 = instr_ticks();
+}
+
+static inline void instr_report(const char* kernel) {
+    double seconds_per_tick = (omp_get_wtime() - instr_wall0) / (double)(instr_ticks() - instr_tick0);
+    double total[INSTR_PHASES], slowest[INSTR_PHASES];
+    long calls[INSTR_PHASES], counts[INSTR_COUNTERS];
+    int threads = 0;
+    memset(total, 0, sizeof(total));
+    memset(slowest, 0, sizeof(slowest));
+    memset(calls, 0, sizeof(calls));
+    memset(counts, 0, sizeof(counts));
+#ifdef INSTRUMENT_PERF
+    unsigned long long perf[INSTR_PHASES][INSTR_EVENTS];
+    int have_perf = 0;
+    memset(perf, 0, sizeof(perf));
+#endif
+
+    for (int i = 0; i < INSTR_MAX_THREADS; i++) {
+        InstrThread* t = &instr_threads[i];
+        int used = 0;
+        for (int p = 0; p < INSTR_PHASES; p++) {
+            double s = t->ticks[p] * seconds_per_tick;
+            total[p] += s;
+            if (s > slowest[p])
+                slowest[p] = s;
+            calls[p] += t->calls[p];
+            used |= t->calls[p] != 0;
+#ifdef INSTRUMENT_PERF
+            for (int e = 0; e < INSTR_EVENTS; e++)
+                perf[p][e] += t->perf[p][e];
+            have_perf |= t->perf_fd > 0;
+#endif
+        }
+        for (int c = 0; c < INSTR_COUNTERS; c++) {
+            counts[c] += t->counts[c];
+            used |= t->counts[c] != 0;
+        }
+        if (used)
+            threads = i + 1;
+    }
+
+    printf("Instrumentation for %s (%d threads)\n", kernel, threads);
+    printf("%-12s %12s %14s %16s", "Phase", "Calls", "Thread-sum (s)", "Slowest thread (s)");
+#ifdef INSTRUMENT_PERF
+    printf(" %14s %14s %6s %12s %13s", "Cycles", "Instructions", "IPC", "LLC misses", "Branch misses");
+#endif
+    printf("\n");
+    for (int p = 0; p < INSTR_PHASES; p++) {
+        if (calls[p] == 0)
+            continue;
+        printf("%-12s %12ld %14.6f %16.6f", instr_phase_names[p], calls[p], total[p], slowest[p]);
+#ifdef INSTRUMENT_PERF
+        if (have_perf)
+            printf(" %14llu %14llu %6.2f %12llu %13llu", perf[p][0], perf[p][1],
+                   perf[p][0] ? (double)perf[p][1] / perf[p][0] : 0.0, perf[p][2], perf[p][3]);
+        else
+            printf(" %14s %14s %6s %12s %13s", "n/a", "n/a", "n/a", "n/a", "n/a");
+#endif
+        printf("\n");
+    }
+    printf("Counters:");
+    for (int c = 0; c < INSTR_COUNTERS; c++)
+        printf(" %s %ld%s", instr_counter_names[c], counts[c], c + 1 < INSTR_COUNTERS ? "," : "\n");
+
+    const char* path = getenv("INSTRUMENT_JSON");
+    if (path == NULL)
+        return;
+    FILE* out = fopen(path, "a");
+    if (out == NULL) {
+        fprintf(stderr, "Error: Could not open file %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    fprintf(out, "{\"kernel\":\"%s\",\"threads\":%d,\"phases\":{", kernel, threads);
+    int first = 1;
+    for (int p = 0; p < INSTR_PHASES; p++) {
+        if (calls[p] == 0)
+            continue;
+        fprintf(out, "%s\"%s\":{\"calls\":%ld,\"thread_sum_sec\":%.9f,\"slowest_thread_sec\":%.9f",
+                first ? "" : ",", instr_phase_names[p], calls[p], total[p], slowest[p]);
+#ifdef INSTRUMENT_PERF
+        if (have_perf)
+            fprintf(out, ",\"cycles\":%llu,\"instructions\":%llu,\"llc_misses\":%llu,\"branch_misses\":%llu",
+                    perf[p][0], perf[p][1], perf[p][2], perf[p][3]);
+#endif
+        fprintf(out, "}");
+        first = 0;
+    }
+    fprintf(out, "},\"counters\":{");
+    for (int c = 0; c < INSTR_COUNTERS; c++)
+        fprintf(out, "%s\"%s\":%ld", c ? "," : "", instr_counter_names[c], counts[c]);
+    fprintf(out, "}}\n");
+    fclose(out);
+}
+
+#else
+
+#define INSTR_ENABLED 0
+#define INSTR_BEGIN(phase) ((void)0)
+#define INSTR_END(phase) ((void)0)
+#define INSTR_COUNT(counter, n) ((void)0)
+
+static inline void instr_reset(void) {}
+static inline void instr_report(const char* kernel) { (void)kernel; }
+
+#endif
+
+#endif
@@ -1,38 +1,263 @@
-#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include <omp.h>
-#include <sys/time.h>
+
+#include "bench.h"
+#include "numa.h"
 
 
 #define N 1000
 
-int A[N][N];
-int B[N][N];
-int C[N][N];
-double start_time, end_time;
-int main() 
-{
-    int i,j,k;
-    omp_set_num_threads(omp_get_num_procs());
-    #pragma omp parallel for schedule(dynamic)
-    for (i= 0; i< N; i++)
-        for (j= 0; j< N; j++)
-	{
-            A[i][j] = 2;
-            B[i][j] = 2;
-	}
-    start_time = omp_get_wtime();
-    #pragma omp parallel for private(i,j,k) shared(A,B,C) schedule(dynamic)
-    for (i = 0; i < N; ++i) {
-        for (j = 0; j < N; ++j) {
-            for (k = 0; k < N; ++k) {
-                C[i][j] += A[i][k] * B[k][j];
-            }
+// Cache sizes the GEMM blocking is derived from (per core for L1/L2, the
+// share of L3 one thread can count on). Override with -D for other machines.
+#ifndef GEMM_L1_BYTES
+#define GEMM_L1_BYTES (32 * 1024L)
+#endif
+#ifndef GEMM_L2_BYTES
+#define GEMM_L2_BYTES (1024 * 1024L)
+#endif
+#ifndef GEMM_L3_BYTES
+#define GEMM_L3_BYTES (8 * 1024 * 1024L)
+#endif
+
+// Micro-tile is MR rows by two vectors of columns: 2 * MR accumulators plus
+// two B vectors and a broadcast must fit the register file (32 registers
+// with AVX-512, 16 otherwise).
+#if defined(__AVX512F__)
+#define GEMM_VECTOR_BYTES 64
+#define GEMM_MR 12
+#else
+#define GEMM_VECTOR_BYTES 32
+#define GEMM_MR 6
+#endif
+
+#define GEMM_T int
+#define GEMM_FN(name) i32_##name
+#include "gemm_impl.h"
+#undef GEMM_T
+#undef GEMM_FN
+
+#define GEMM_T float
+#define GEMM_FN(name) f32_##name
+#include "gemm_impl.h"
+#undef GEMM_T
+#undef GEMM_FN
+
+#define GEMM_T double
+#define GEMM_FN(name) f64_##name
+#include "gemm_impl.h"
+#undef GEMM_T
+#undef GEMM_FN
+
+typedef enum { TYPE_INT, TYPE_FLOAT, TYPE_DOUBLE } ElementType;
+
+static const char* type_names[] = { "int32", "float", "double" };
+static const size_t type_sizes[] = { sizeof(int), sizeof(float), sizeof(double) };
+
+// Page-aligned; where the pages go is decided by the first writes, see
+// fill_matrix and zero_matrix, or spread over the nodes for interleave.
+static void* alloc_matrix(long rows, long cols, size_t elem, int policy) {
+    return numa_alloc(rows * cols * elem, policy, "matrix");
+}
+
+// Small integers keep int32 products exact and free of overflow; the
+// floating-point types get values in [-1, 1). Filled on the master thread
+// alone under --numa serial, otherwise in parallel with a static schedule.
+static void fill_matrix(void* M, long count, ElementType type, unsigned seed, int policy) {
+    #pragma omp parallel for schedule(static) if (policy != NUMA_SERIAL)
+    for (long i = 0; i < count; i++) {
+        unsigned h = (unsigned)i * 2654435761u ^ seed * 40503u;
+        h ^= h >> 15;
+        h *= 2246822519u;
+        h ^= h >> 13;
+        if (type == TYPE_INT)
+            ((int*)M)[i] = (int)(h % 7) - 3;
+        else if (type == TYPE_FLOAT)
+            ((float*)M)[i] = (float)(h % 2000) / 1000.0f - 1.0f;
+        else
+            ((double*)M)[i] = (double)(h % 2000) / 1000.0 - 1.0;
+    }
+}
+
+static void run_gemm(ElementType type, long m, long n, long k,
+                     const void* A, const void* B, void* C) {
+    if (type == TYPE_INT)
+        i32_gemm(m, n, k, (const int*)A, k, (const int*)B, n, (int*)C, n);
+    else if (type == TYPE_FLOAT)
+        f32_gemm(m, n, k, (const float*)A, k, (const float*)B, n, (float*)C, n);
+    else
+        f64_gemm(m, n, k, (const double*)A, k, (const double*)B, n, (double*)C, n);
+}
+
+static void run_loop(ElementType type, long m, long n, long k,
+                     const void* A, const void* B, void* C, int parallel) {
+    if (type == TYPE_INT)
+        i32_gemm_loop(m, n, k, (const int*)A, (const int*)B, (int*)C, parallel);
+    else if (type == TYPE_FLOAT)
+        f32_gemm_loop(m, n, k, (const float*)A, (const float*)B, (float*)C, parallel);
+    else
+        f64_gemm_loop(m, n, k, (const double*)A, (const double*)B, (double*)C, parallel);
+}
+
+static void run_peak(void* arg) {
+    ElementType type = *(const ElementType*)arg;
+    if (type == TYPE_INT)
+        i32_peak_run();
+    else if (type == TYPE_FLOAT)
+        f32_peak_run();
+    else
+        f64_peak_run();
+}
+
+// Peak rate of the current team, timed with the same warmup and reps as
+// the kernels; the fastest rep is the ceiling, a single cold run is not.
+static double peak_rate(const BenchConfig* cfg, ElementType type) {
+    BenchStats stats;
+    bench_measure(cfg, NULL, run_peak, &type, &stats);
+    double ops = type == TYPE_INT ? i32_peak_ops() : type == TYPE_FLOAT ? f32_peak_ops() : f64_peak_ops();
+    return ops / stats.min;
+}
+
+// Largest difference to the reference relative to the largest reference
+// value; exact (0) for int32.
+static double max_error(ElementType type, const void* C, const void* ref, long count) {
+    double diff = 0, scale = 0;
+    for (long i = 0; i < count; i++) {
+        double c, r;
+        if (type == TYPE_INT) {
+            c = ((const int*)C)[i];
+            r = ((const int*)ref)[i];
+        } else if (type == TYPE_FLOAT) {
+            c = ((const float*)C)[i];
+            r = ((const float*)ref)[i];
+        } else {
+            c = ((const double*)C)[i];
+            r = ((const double*)ref)[i];
         }
+        diff = fmax(diff, fabs(c - r));
+        scale = fmax(scale, fabs(r));
+    }
+    return scale > 0 ? diff / scale : diff;
+}
+
+// C is written by whichever thread takes each tile, so a static split of
+// its rows is as close to its later users as first touch can get.
+static void zero_matrix(void* M, long rows, long cols, size_t elem, int policy) {
+    #pragma omp parallel for schedule(static) if (policy != NUMA_SERIAL)
+    for (long i = 0; i < rows; i++)
+        memset((char*)M + i * cols * elem, 0, cols * elem);
+}
+
+// One timed run of the i-j-k loop; C is zeroed first.
+static double time_loop(ElementType type, long m, long n, long k, const void* A,
+                        const void* B, void* C, int parallel, int policy) {
+    zero_matrix(C, m, n, type_sizes[type], policy);
+    double start_time = omp_get_wtime();
+    run_loop(type, m, n, k, A, B, C, parallel);
+    return omp_get_wtime() - start_time;
+}
+
+typedef struct {
+    ElementType type;
+    long m, n, k;
+    const void* A;
+    const void* B;
+    void* C;
+    int policy;
+} GemmRun;
+
+static void zero_c(void* arg) {
+    GemmRun* r = (GemmRun*)arg;
+    zero_matrix(r->C, r->m, r->n, type_sizes[r->type], r->policy);
+}
+
+static void run_packed(void* arg) {
+    GemmRun* r = (GemmRun*)arg;
+    run_gemm(r->type, r->m, r->n, r->k, r->A, r->B, r->C);
+}
+
+// matrixmultiplication [n | MxNxK] [int|float|double|all] --threads 1-16 --numa first-touch --csv results.csv
+int main(int argc, char* argv[])
+{
+    BenchConfig cfg;
+    bench_parse_args(&argc, argv, &cfg);
+    int policy = parse_numa_policy(cfg.numa);
+    long m = N, n = N, k = N;
+    if (argc > 1 && sscanf(argv[1], "%ldx%ldx%ld", &m, &n, &k) != 3)
+        m = n = k = atol(argv[1]);
+    if (m <= 0 || n <= 0 || k <= 0) {
+        fprintf(stderr, "Error: Matrix sizes must be positive\n");
+        return 1;
     }
+    const char* which = argc > 2 ? argv[2] : "all";
+
+    // The old loop and the peak are measured at the largest thread count.
+    int max_threads = 1;
+    for (int i = 0; i < cfg.num_thread_counts; i++)
+        if (cfg.threads[i] > max_threads)
+            max_threads = cfg.threads[i];
+
+    double flops = 2.0 * m * n * k;
+    char input[64];
+    snprintf(input, sizeof(input), "%ldx%ldx%ld, %s", m, n, k, numa_policy_name(policy));
+    printf("C (%ld x %ld) = A (%ld x %ld) * B (%ld x %ld)\n", m, n, m, k, k, n);
 
-    end_time = omp_get_wtime();
-    printf("Time taken: %f seconds\n", end_time - start_time); 
+    for (int t = TYPE_INT; t <= TYPE_DOUBLE; t++) {
+        ElementType type = (ElementType)t;
+        if (strcmp(which, "all") != 0 && strncmp(type_names[t], which, strlen(which)) != 0)
+            continue;
 
-}
\ No newline at end of file
+        size_t elem = type_sizes[type];
+        void* A = alloc_matrix(m, k, elem, policy);
+        void* B = alloc_matrix(k, n, elem, policy);
+        void* C = alloc_matrix(m, n, elem, policy);
+        void* ref = alloc_matrix(m, n, elem, policy);
+        fill_matrix(A, m * k, type, 1, policy);
+        fill_matrix(B, k * n, type, 2, policy);
+
+        omp_set_num_threads(max_threads);
+        double peak = peak_rate(&cfg, type);
+        double naive = time_loop(type, m, n, k, A, B, ref, 0, policy);
+        double loop = time_loop(type, m, n, k, A, B, C, 1, policy);
+
+        BenchStats* stats = (BenchStats*)malloc(cfg.num_thread_counts * sizeof(BenchStats));
+        if (stats == NULL) {
+            fprintf(stderr, "Error: Could not allocate benchmark results\n");
+            return 1;
+        }
+        GemmRun run = { type, m, n, k, A, B, C, policy };
+        const BenchStats* widest = &stats[0];
+        for (int i = 0; i < cfg.num_thread_counts; i++) {
+            omp_set_num_threads(cfg.threads[i]);
+            bench_measure(&cfg, zero_c, run_packed, &run, &stats[i]);
+            if (stats[i].threads >= widest->threads)
+                widest = &stats[i];
+        }
+        double error = max_error(type, C, ref, m * n);
+        // Clocks drift over a run; the peak is measured again after the
+        // GEMM and the higher of the two kept, so it bounds both.
+        omp_set_num_threads(max_threads);
+        peak = fmax(peak, peak_rate(&cfg, type));
+
+        char kernel[32];
+        snprintf(kernel, sizeof(kernel), "gemm-%s", type_names[t]);
+        bench_report(&cfg, kernel, input, stats, cfg.num_thread_counts, flops / 1e9, "GFLOP/s");
+
+        double packed = widest->median;
+        printf("%s at %d threads: peak %.2f GFLOP/s\n", type_names[t], max_threads, peak / 1e9);
+        printf("  naive serial i-j-k  (in sec): %.4f, %.2f GFLOP/s\n", naive, flops / naive / 1e9);
+        printf("  parallel i-j-k loop (in sec): %.4f, %.2f GFLOP/s\n", loop, flops / loop / 1e9);
+        printf("  packed GEMM         (in sec): %.4f, %.2f GFLOP/s, %.1f%% of peak, %.1fx over loop, max rel error %.2e%s\n",
+               packed, flops / packed / 1e9, 100.0 * flops / packed / peak, loop / packed, error,
+               error > (type == TYPE_FLOAT ? 1e-4 : 1e-10) ? ", RESULT DIFFERS" : "");
+
+        free(stats);
+        free(A);
+        free(B);
+        free(C);
+        free(ref);
+    }
+    return 0;
+}
@@ -0,0 +1,165 @@
+#ifndef MULTIQUEUE_H
+#define MULTIQUEUE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+// Relaxed concurrent priority queue (MultiQueue, Rihani, Sanders and
+// Dementiev): c * p sequential 4-ary min-heaps of 64-bit keys, each behind
+// a one-byte try-lock. A push goes to a random heap; a pop looks at the
+// cached minimum of two random heaps and takes from the smaller. Neither
+// ever waits on a lock: a heap that is busy is skipped for another random
+// one. Pops return one of the smallest keys with high probability rather
+// than the smallest, so a caller must tolerate a little disorder; in
+// exchange all threads push and pop at once with no shared hot spot.
+//
+// Keys order as unsigned integers; MQ_EMPTY is reserved.
+#define MQ_EMPTY (~0ULL)
+
+typedef struct {
+    unsigned long long* keys;
+    long size;
+    long capacity;
+    unsigned long long top;   // keys[0] or MQ_EMPTY, readable without the lock
+    unsigned char lock;
+} __attribute__((aligned(64))) MqHeap;
+
+typedef struct {
+    MqHeap* heaps;
+    int num_heaps;
+} MultiQueue;
+
+// Per-thread random state for picking heaps (xorshift64, must not be 0).
+static inline unsigned mq_random(unsigned long long* state) {
+    unsigned long long x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return (unsigned)(x >> 32);
+}
+
+// num_heaps heaps with room for capacity keys each to start with; heaps
+// grow on demand.
+static inline void mq_init(MultiQueue* q, int num_heaps, long capacity) {
+    q->num_heaps = num_heaps;
+    q->heaps = (MqHeap*)aligned_alloc(64, num_heaps * sizeof(MqHeap));
+    if (q->heaps == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for %d heaps\n", num_heaps);
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < num_heaps; i++) {
+        MqHeap* h = &q->heaps[i];
+        h->capacity = capacity > 16 ? capacity : 16;
+        h->keys = (unsigned long long*)malloc(h->capacity * sizeof(unsigned long long));
+        if (h->keys == NULL) {
+            fprintf(stderr, "Error: Could not allocate memory for heap of %ld keys\n", h->capacity);
+            exit(EXIT_FAILURE);
+        }
+        h->size = 0;
+        h->top = MQ_EMPTY;
+        h->lock = 0;
+    }
+}
+
+static inline void mq_free(MultiQueue* q) {
+    for (int i = 0; i < q->num_heaps; i++)
+        free(q->heaps[i].keys);
+    free(q->heaps);
+    q->heaps = NULL;
+}
+
+static inline bool mq_try_lock(MqHeap* h) {
+    return !__atomic_load_n(&h->lock, __ATOMIC_RELAXED) && !__atomic_test_and_set(&h->lock, __ATOMIC_ACQUIRE);
+}
+
+static inline void mq_unlock(MqHeap* h) {
+    __atomic_store_n(&h->top, h->size ? h->keys[0] : MQ_EMPTY, __ATOMIC_RELAXED);
+    __atomic_clear(&h->lock, __ATOMIC_RELEASE);
+}
+
+static inline void mq_heap_push(MqHeap* h, unsigned long long key) {
+    if (h->size == h->capacity) {
+        h->capacity *= 2;
+        h->keys = (unsigned long long*)realloc(h->keys, h->capacity * sizeof(unsigned long long));
+        if (h->keys == NULL) {
+            fprintf(stderr, "Error: Could not grow heap to %ld keys\n", h->capacity);
+            exit(EXIT_FAILURE);
+        }
+    }
+    long i = h->size++;
+    while (i > 0) {
+        long parent = (i - 1) >> 2;
+        if (h->keys[parent] <= key)
+            break;
+        h->keys[i] = h->keys[parent];
+        i = parent;
+    }
+    h->keys[i] = key;
+}
+
+static inline unsigned long long mq_heap_pop(MqHeap* h) {
+    unsigned long long root = h->keys[0];
+    unsigned long long x = h->keys[--h->size];
+    long i = 0;
+    for (;;) {
+        long first = (i << 2) + 1;
+        if (first >= h->size)
+            break;
+        long last = first + 4 < h->size ? first + 4 : h->size;
+        long best = first;
+        for (long c = first + 1; c < last; c++)
+            if (h->keys[c] < h->keys[best])
+                best = c;
+        if (h->keys[best] >= x)
+            break;
+        h->keys[i] = h->keys[best];
+        i = best;
+    }
+    if (h->size)
+        h->keys[i] = x;
+    return root;
+}
+
+// Inserts key into some heap; retries other random heaps while the one
+// picked is locked.
+static inline void mq_push(MultiQueue* q, unsigned long long* rng, unsigned long long key) {
+    for (;;) {
+        MqHeap* h = &q->heaps[mq_random(rng) % q->num_heaps];
+        if (mq_try_lock(h)) {
+            mq_heap_push(h, key);
+            mq_unlock(h);
+            return;
+        }
+    }
+}
+
+// Removes the minimum of the better of two random heaps into *key. Returns
+// false when both are empty; the queue as a whole may still hold keys, so
+// callers need their own termination test (see sssp_multiqueue).
+static inline bool mq_pop(MultiQueue* q, unsigned long long* rng, unsigned long long* key) {
+    for (;;) {
+        MqHeap* a = &q->heaps[mq_random(rng) % q->num_heaps];
+        MqHeap* b = &q->heaps[mq_random(rng) % q->num_heaps];
+        unsigned long long ta = __atomic_load_n(&a->top, __ATOMIC_RELAXED);
+        unsigned long long tb = __atomic_load_n(&b->top, __ATOMIC_RELAXED);
+        if (tb < ta) {
+            a = b;
+            ta = tb;
+        }
+        if (ta == MQ_EMPTY)
+            return false;
+        if (!mq_try_lock(a))
+            continue;
+        if (a->size == 0) {
+            mq_unlock(a);
+            continue;
+        }
+        *key = mq_heap_pop(a);
+        mq_unlock(a);
+        return true;
+    }
+}
+
+#endif
@@ -0,0 +1,242 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <omp.h>
+
+#include "graph.h"
+#include "atomicUtil.h"
+
+// Memory placement for multi-socket machines, without a libnuma
+// dependency: topology comes from /sys/devices/system/node and policies
+// are set with the raw mbind and sched_setaffinity system calls. Linux
+// puts a page on the node of the thread that first writes it, so a large
+// array initialised by the master thread lands entirely on its socket and
+// every other socket reads it over the interconnect. The policies:
+//   serial       master thread initialises everything (the old behaviour,
+//                kept as the baseline)
+//   first-touch  each thread initialises the part it later works on, with
+//                the same static schedule as the kernel
+//   interleave   pages round-robin over all nodes; for data every thread
+//                reads in no particular order, such as graph arrays
+//   replicate    one copy of the read-only graph arrays per node, read by
+//                the threads of that node (numa_replicate_graph)
+// On a single-node machine all of them place memory the same way; only
+// serial still differs, in having one thread do the initialisation.
+
+#define NUMA_MAX_NODES 64
+#define NUMA_MAX_CPUS 4096
+#define NUMA_PAGE 4096L
+
+enum { NUMA_SERIAL, NUMA_FIRST_TOUCH, NUMA_INTERLEAVE, NUMA_REPLICATE, NUMA_POLICIES };
+
+// From linux/mempolicy.h.
+#define NUMA_MPOL_INTERLEAVE 3
+#define NUMA_MPOL_MF_MOVE (1 << 1)
+
+static inline const char* numa_policy_name(int policy) {
+    static const char* names[NUMA_POLICIES] = { "serial", "first-touch", "interleave", "replicate" };
+    return policy >= 0 && policy < NUMA_POLICIES ? names[policy] : "unknown";
+}
+
+// NULL selects first-touch.
+static inline int parse_numa_policy(const char* name) {
+    if (name == NULL)
+        return NUMA_FIRST_TOUCH;
+    for (int p = 0; p < NUMA_POLICIES; p++)
+        if (strcmp(name, numa_policy_name(p)) == 0)
+            return p;
+    fprintf(stderr, "Error: Unknown NUMA policy %s (expected serial, first-touch, interleave or replicate)\n", name);
+    exit(EXIT_FAILURE);
+}
+
+// Calls visit(lo, hi, arg) for every range of a sysfs list like "0-15,32-47".
+static inline int numa_read_list(const char* path, void (*visit)(long, long, void*), void* arg) {
+    FILE* f = fopen(path, "r");
+    if (f == NULL)
+        return 0;
+    char line[4096];
+    int ok = fgets(line, sizeof(line), f) != NULL;
+    fclose(f);
+    for (char* p = line; ok && *p >= '0' && *p <= '9';) {
+        char* end;
+        long lo = strtol(p, &end, 10), hi = lo;
+        if (*end == '-')
+            hi = strtol(end + 1, &end, 10);
+        visit(lo, hi, arg);
+        p = *end == ',' ? end + 1 : end;
+    }
+    return ok;
+}
+
+static inline void numa_visit_max(long lo, long hi, void* arg) {
+    (void)lo;
+    if (hi > *(long*)arg)
+        *(long*)arg = hi;
+}
+
+static inline void numa_visit_cpus(long lo, long hi, void* arg) {
+    unsigned long* mask = (unsigned long*)arg;
+    for (long c = lo; c <= hi && c < NUMA_MAX_CPUS; c++)
+        mask[c / (8 * sizeof(long))] |= 1UL << (c % (8 * sizeof(long)));
+}
+
+// Number of NUMA nodes (1 when the kernel exposes none).
+static inline int numa_num_nodes(void) {
+    static int nodes = 0;
+    if (nodes == 0) {
+        long last = 0;
+        numa_read_list("/sys/devices/system/node/online", numa_visit_max, &last);
+        nodes = last + 1 < NUMA_MAX_NODES ? (int)last + 1 : NUMA_MAX_NODES;
+    }
+    return nodes;
+}
+
+// Fills mask with the CPUs of node; returns how many there are.
+static inline int numa_node_cpus(int node, unsigned long mask[NUMA_MAX_CPUS / (8 * sizeof(long))]) {
+    memset(mask, 0, NUMA_MAX_CPUS / 8);
+    char path[96];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    if (!numa_read_list(path, numa_visit_cpus, mask) && node == 0)
+        numa_visit_cpus(0, sysconf(_SC_NPROCESSORS_ONLN) - 1, mask);
+    int count = 0;
+    for (size_t i = 0; i < NUMA_MAX_CPUS / (8 * sizeof(long)); i++)
+        count += __builtin_popcountl(mask[i]);
+    return count;
+}
+
+// Node of the CPU the calling thread runs on, or 0 if unknown.
+static inline int numa_current_node(void) {
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0 || node >= NUMA_MAX_NODES)
+        return 0;
+    return (int)node;
+}
+
+// Pins the calling thread to the CPUs of node. Returns 0 on success.
+static inline int numa_bind_node(int node) {
+    unsigned long mask[NUMA_MAX_CPUS / (8 * sizeof(long))];
+    if (numa_node_cpus(node, mask) == 0)
+        return -1;
+    return (int)syscall(SYS_sched_setaffinity, 0, sizeof(mask), mask);
+}
+
+// Interleaves the pages of [p, p + bytes) over all nodes, moving those
+// already placed. The range is widened to whole pages, so p should come
+// from numa_alloc: on malloc'd memory the neighbouring heap data would move
+// too. Silently does nothing on one node or where mbind is not available.
+static inline void numa_interleave(void* p, size_t bytes) {
+    int nodes = numa_num_nodes();
+    if (nodes < 2 || p == NULL || bytes == 0)
+        return;
+    unsigned long mask[NUMA_MAX_NODES / (8 * sizeof(long)) + 1] = { 0 };
+    for (int i = 0; i < nodes; i++)
+        mask[i / (8 * sizeof(long))] |= 1UL << (i % (8 * sizeof(long)));
+    unsigned long start = (unsigned long)p & ~(NUMA_PAGE - 1);
+    unsigned long end = ((unsigned long)p + bytes + NUMA_PAGE - 1) & ~(NUMA_PAGE - 1);
+    if (syscall(SYS_mbind, start, end - start, NUMA_MPOL_INTERLEAVE, mask,
+                (unsigned long)(8 * sizeof(mask)), NUMA_MPOL_MF_MOVE) != 0) {
+        static int warned = 0;
+        if (!warned++)
+            perror("Warning: mbind failed, memory left where it is");
+    }
+}
+
+// Page-aligned allocation of bytes (rounded up to whole pages) for an
+// array to be placed under policy. Nothing is touched: with interleave the
+// pages are spread once written, otherwise the caller's initialisation
+// decides where they go.
+static inline void* numa_alloc(size_t bytes, int policy, const char* what) {
+    size_t rounded = (bytes + NUMA_PAGE - 1) / NUMA_PAGE * NUMA_PAGE;
+    void* p = aligned_alloc(NUMA_PAGE, rounded ? rounded : NUMA_PAGE);
+    if (p == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for %s\n", what);
+        exit(EXIT_FAILURE);
+    }
+    if (policy == NUMA_INTERLEAVE)
+        numa_interleave(p, rounded);
+    return p;
+}
+
+// Read-only copies of a graph's CSR arrays, one per node. nodeLabel and
+// the mapping stay shared with the original.
+typedef struct {
+    Graph copies[NUMA_MAX_NODES];
+    unsigned char made[NUMA_MAX_NODES];
+    int num_nodes;
+} GraphReplicas;
+
+// Each node's copy is allocated and filled by the first thread of the
+// current team found running there, so its pages land on that node; run
+// with bound threads (--bind) so the team spans every node and stays put.
+// Nodes with no thread get no copy and fall back to the original. Does
+// nothing on one node.
+static inline void graph_replicate(GraphReplicas* r, const Graph* g) {
+    memset(r, 0, sizeof(*r));
+    r->num_nodes = numa_num_nodes();
+    if (r->num_nodes < 2)
+        return;
+    #pragma omp parallel
+    {
+        int node = numa_current_node();
+        if (testAndSetFlag(&r->made[node])) {
+            Graph* c = &r->copies[node];
+            *c = *g;
+            c->mapping = NULL;
+            c->mapping_size = 0;
+            c->indexofNodes = (long*)graph_malloc((g->num_nodes + 1) * sizeof(long), "replica offsets");
+            c->edgeList = (int*)graph_malloc(g->num_edges * sizeof(int), "replica edges");
+            c->edgeLen = (int*)graph_malloc(g->num_edges * sizeof(int), "replica weights");
+            memcpy(c->indexofNodes, g->indexofNodes, (g->num_nodes + 1) * sizeof(long));
+            memcpy(c->edgeList, g->edgeList, g->num_edges * sizeof(int));
+            memcpy(c->edgeLen, g->edgeLen, g->num_edges * sizeof(int));
+        }
+    }
+}
+
+static inline void graph_replicas_free(GraphReplicas* r) {
+    for (int i = 0; i < NUMA_MAX_NODES; i++)
+        if (r->made[i]) {
+            free(r->copies[i].indexofNodes);
+            free(r->copies[i].edgeList);
+            free(r->copies[i].edgeLen);
+        }
+    memset(r, 0, sizeof(*r));
+}
+
+// The copy local to the calling thread, or g if there is none (r may be NULL).
+static inline const Graph* graph_replica(const GraphReplicas* r, const Graph* g) {
+    if (r == NULL || r->num_nodes < 2)
+        return g;
+    int node = numa_current_node();
+    return r->made[node] ? &r->copies[node] : g;
+}
+
+// Replaces the malloc'd array *p by an interleaved numa_alloc copy.
+static inline void numa_interleave_array(void** p, size_t bytes, const char* what) {
+    void* copy = numa_alloc(bytes, NUMA_INTERLEAVE, what);
+    memcpy(copy, *p, bytes);
+    free(*p);
+    *p = copy;
+}
+
+// Applies policy to a graph that is only read from now on: interleave
+// moves its arrays into interleaved pages of their own, replicate fills r.
+// Arrays served from a file mapping (see graph_io.h) are left alone.
+static inline void numa_place_graph(Graph* g, int policy, GraphReplicas* r) {
+    if (r)
+        memset(r, 0, sizeof(*r));
+    if (policy == NUMA_INTERLEAVE && g->mapping == NULL && numa_num_nodes() > 1) {
+        numa_interleave_array((void**)&g->indexofNodes, (g->num_nodes + 1) * sizeof(long), "graph offsets");
+        numa_interleave_array((void**)&g->edgeList, g->num_edges * sizeof(int), "edge list");
+        numa_interleave_array((void**)&g->edgeLen, g->num_edges * sizeof(int), "edge weights");
+    } else if (policy == NUMA_REPLICATE && r) {
+        graph_replicate(r, g);
+    }
+}
+
+#endif
@@ -0,0 +1,970 @@
+#ifndef SSSP_H
+#define SSSP_H
+
+#include <string.h>
+#include <limits.h>
+#include <omp.h>
+#include "graph.h"
+#include "heap.h"
+#include "atomicUtil.h"
+#include "multiqueue.h"
+#include "bucket_queue.h"
+#include "numa.h"
+
+// Single-threaded Dijkstra with a caller-owned heap, for running many
+// sources side by side with one search per thread. The heap must have room
+// for g->num_nodes vertices and is left empty. Unreachable vertices get
+// INT_MAX. Weights must be non-negative.
+static inline void dijkstra_serial(const Graph* g, int src, int* dist, IndexedHeap* heap) {
+    for (int v = 0; v < g->num_nodes; v++)
+        dist[v] = INT_MAX;
+    dist[src] = 0;
+    heap_push_or_decrease(heap, src, 0);
+
+    while (!heap_empty(heap)) {
+        int u = heap_pop(heap).node;
+        int du = dist[u];
+        for (long i = g->indexofNodes[u]; i < g->indexofNodes[u + 1]; i++) {
+            int v = g->edgeList[i];
+            int nd = du + g->edgeLen[i];
+            if (nd < dist[v]) {
+                dist[v] = nd;
+                heap_push_or_decrease(heap, v, nd);
+            }
+        }
+    }
+}
+
+#define SSSP_MAX_THREADS 256
+
+// How sssp_batch_run spreads a batch over the team.
+#define SSSP_BATCH_AUTO 0    // inter-query, the tail intra-query on large graphs
+#define SSSP_BATCH_INTER 1   // every query on one thread with dijkstra_serial
+#define SSSP_BATCH_INTRA 2   // queries one after another, each on the whole team
+
+// A single search must have at least this many edges to be worth splitting
+// across the team; below it the tail of a batch runs one query per thread
+// as well, with the rest of the team idle.
+#ifndef SSSP_INTRA_MIN_EDGES
+#define SSSP_INTRA_MIN_EDGES (1L << 20)
+#endif
+// Vertices a thread collects before reserving space in the next frontier.
+#define SSSP_FRONTIER_CHUNK 256
+
+// Called once per finished query with its distance row, from the thread
+// that finished it. The row is scratch and only valid during the call.
+typedef void (*SsspEmit)(int query, int src, const int* dist, void* arg);
+
+// State shared by the team during one intra-query search.
+typedef struct {
+    int* dist;
+    unsigned char* queued;   // vertex is in next
+    int* frontier;
+    int* next;
+    long size;
+    long next_size;
+} SsspTeam;
+
+// Reusable buffers for answering batches of sources over one read-only
+// graph. Each thread allocates (and first touches) its own heap and
+// distance row on first use; they are kept until sssp_batch_free.
+// Inter-query searches read the copy of g on their own NUMA node when
+// replicas is set (see graph_replicate).
+typedef struct {
+    const Graph* g;
+    const GraphReplicas* replicas;
+    IndexedHeap* heaps[SSSP_MAX_THREADS];
+    int* dists[SSSP_MAX_THREADS];
+    SsspTeam team;
+} SsspBatch;
+
+static inline void sssp_batch_init(SsspBatch* b, const Graph* g) {
+    memset(b, 0, sizeof(*b));
+    b->g = g;
+}
+
+static inline void sssp_batch_free(SsspBatch* b) {
+    for (int t = 0; t < SSSP_MAX_THREADS; t++) {
+        if (b->heaps[t] != NULL)
+            heap_free(b->heaps[t]);
+        free(b->dists[t]);
+    }
+    free(b->team.dist);
+    free(b->team.queued);
+    free(b->team.frontier);
+    free(b->team.next);
+    memset(b, 0, sizeof(*b));
+}
+
+// Frontier-based label-correcting search from src, run by the whole team:
+// every thread of the enclosing parallel region must call it. Vertices
+// whose distance drops are queued once per round through the queued flags
+// and relaxed in the next round; threads append to the next frontier in
+// chunks. Leaves the result in t->dist.
+static inline void sssp_frontier(const Graph* g, int src, SsspTeam* t) {
+    int n = g->num_nodes;
+    #pragma omp for schedule(static)
+    for (int v = 0; v < n; v++) {
+        t->dist[v] = INT_MAX;
+        t->queued[v] = 0;
+    }
+    #pragma omp single
+    {
+        t->dist[src] = 0;
+        t->frontier[0] = src;
+        t->size = 1;
+        t->next_size = 0;
+    }
+
+    while (t->size > 0) {
+        int local[SSSP_FRONTIER_CHUNK];
+        int k = 0;
+        #pragma omp for schedule(dynamic, 64) nowait
+        for (long i = 0; i < t->size; i++) {
+            int u = t->frontier[i];
+            clearFlag(&t->queued[u]);
+            int du = __atomic_load_n(&t->dist[u], __ATOMIC_RELAXED);
+            for (long e = g->indexofNodes[u]; e < g->indexofNodes[u + 1]; e++) {
+                int v = g->edgeList[e];
+                int nd = du + g->edgeLen[e];
+                if (nd < t->dist[v] && atomicMin(&t->dist[v], nd) &&
+                    testAndSetFlag(&t->queued[v])) {
+                    if (k == SSSP_FRONTIER_CHUNK) {
+                        long at = __atomic_fetch_add(&t->next_size, k, __ATOMIC_RELAXED);
+                        memcpy(t->next + at, local, k * sizeof(int));
+                        k = 0;
+                    }
+                    local[k++] = v;
+                }
+            }
+        }
+        if (k > 0) {
+            long at = __atomic_fetch_add(&t->next_size, k, __ATOMIC_RELAXED);
+            memcpy(t->next + at, local, k * sizeof(int));
+        }
+        #pragma omp barrier
+        #pragma omp single
+        {
+            int* swap = t->frontier;
+            t->frontier = t->next;
+            t->next = swap;
+            t->size = t->next_size;
+            t->next_size = 0;
+        }
+    }
+}
+
+// Answers count queries, sources[q] being the source of query q, with the
+// current number of OpenMP threads. Low-degree graphs scale far better
+// with one query per thread than with parallelism inside a search, so
+// that is the default; SSSP_BATCH_AUTO only hands the last count % threads
+// queries, which would otherwise leave most of the team idle, to the whole
+// team, and only when the graph has SSSP_INTRA_MIN_EDGES edges. latency
+// (may be NULL) receives the time each query took, in seconds; emit (may
+// be NULL) sees every distance row. Returns the number of queries that ran
+// intra-query.
+static inline int sssp_batch_run(SsspBatch* b, const int* sources, int count, int mode,
+                                 SsspEmit emit, void* arg, double* latency) {
+    const Graph* g = b->g;
+    int n = g->num_nodes;
+    int threads = omp_get_max_threads();
+    if (threads > SSSP_MAX_THREADS) {
+        fprintf(stderr, "Error: More than %d threads\n", SSSP_MAX_THREADS);
+        exit(EXIT_FAILURE);
+    }
+    int inter = count;
+    if (mode == SSSP_BATCH_INTRA)
+        inter = 0;
+    else if (mode == SSSP_BATCH_AUTO && threads > 1 && g->num_edges >= SSSP_INTRA_MIN_EDGES)
+        inter = count - count % threads;
+
+    if (inter < count && b->team.dist == NULL) {
+        b->team.dist = (int*)graph_malloc(n * sizeof(int), "distances");
+        b->team.queued = (unsigned char*)graph_malloc(n, "frontier flags");
+        b->team.frontier = (int*)graph_malloc(n * sizeof(int), "frontier");
+        b->team.next = (int*)graph_malloc(n * sizeof(int), "frontier");
+    }
+
+    #pragma omp parallel
+    {
+        int tid = omp_get_thread_num();
+        const Graph* local = graph_replica(b->replicas, g);
+        if (inter > 0 && b->heaps[tid] == NULL) {
+            b->heaps[tid] = heap_create(n, 4);
+            b->dists[tid] = (int*)graph_malloc(n * sizeof(int), "distance row");
+        }
+
+        #pragma omp for schedule(dynamic, 1)
+        for (int q = 0; q < inter; q++) {
+            double start = omp_get_wtime();
+            dijkstra_serial(local, sources[q], b->dists[tid], b->heaps[tid]);
+            if (latency)
+                latency[q] = omp_get_wtime() - start;
+            if (emit)
+                emit(q, sources[q], b->dists[tid], arg);
+        }
+
+        for (int q = inter; q < count; q++) {
+            double start = omp_get_wtime();
+            sssp_frontier(g, sources[q], &b->team);
+            #pragma omp single
+            {
+                if (latency)
+                    latency[q] = omp_get_wtime() - start;
+                if (emit)
+                    emit(q, sources[q], b->team.dist, arg);
+            }
+        }
+    }
+    return count - inter;
+}
+
+// Point-to-point queries. Distances, parents and heaps are allocated once
+// and after a query only the vertices it reached are reset, so a query
+// costs time proportional to the part of the graph it explores instead of
+// O(V). Side 0 searches forward from s over g, side 1 backward from t over
+// the transpose.
+typedef struct {
+    const Graph* g;
+    int* dist;
+    int* parent;
+    int* touched;            // vertices with a finite dist, for the reset
+    int num_touched;
+    IndexedHeap* heap;
+    long settled;
+    int top;                 // key of the last vertex popped, read by the other side
+} __attribute__((aligned(64))) SsspSide;
+
+typedef struct {
+    SsspSide side[2];
+    unsigned long long best; // (length << 32) | meeting vertex of the best s-t path seen
+    int done;
+} SsspPointQuery;
+
+// rev is the transpose of g (see transpose_graph) and may be NULL when only
+// sssp_point_query is used.
+static inline void sssp_point_init(SsspPointQuery* q, const Graph* g, const Graph* rev) {
+    int n = g->num_nodes;
+    memset(q, 0, sizeof(*q));
+    for (int d = 0; d < 2; d++) {
+        SsspSide* side = &q->side[d];
+        side->g = d == 0 ? g : rev;
+        if (side->g == NULL)
+            continue;
+        side->dist = (int*)graph_malloc(n * sizeof(int), "distances");
+        side->parent = (int*)graph_malloc(n * sizeof(int), "parents");
+        side->touched = (int*)graph_malloc(n * sizeof(int), "visited list");
+        side->heap = heap_create(n, 4);
+        for (int v = 0; v < n; v++) {
+            side->dist[v] = INT_MAX;
+            side->parent[v] = -1;
+        }
+    }
+}
+
+static inline void sssp_point_free(SsspPointQuery* q) {
+    for (int d = 0; d < 2; d++) {
+        SsspSide* side = &q->side[d];
+        if (side->g == NULL)
+            continue;
+        free(side->dist);
+        free(side->parent);
+        free(side->touched);
+        heap_free(side->heap);
+    }
+    memset(q, 0, sizeof(*q));
+}
+
+static inline void sssp_side_start(SsspSide* side, int root) {
+    side->dist[root] = 0;
+    side->touched[0] = root;
+    side->num_touched = 1;
+    side->settled = 0;
+    side->top = 0;
+    heap_push_or_decrease(side->heap, root, 0);
+}
+
+static inline void sssp_side_reset(SsspSide* side) {
+    for (int i = 0; i < side->num_touched; i++) {
+        side->dist[side->touched[i]] = INT_MAX;
+        side->parent[side->touched[i]] = -1;
+    }
+    side->num_touched = 0;
+    heap_clear(side->heap);
+}
+
+// Writes the path s .. meet (forward parents) .. t (backward parents) to
+// path, if not NULL, and returns its number of vertices.
+static inline int sssp_point_path(const SsspPointQuery* q, int meet, int* path) {
+    int len = 0;
+    for (int v = meet; v >= 0; v = q->side[0].parent[v])
+        len++;
+    if (path != NULL) {
+        int i = len;
+        for (int v = meet; v >= 0; v = q->side[0].parent[v])
+            path[--i] = v;
+    }
+    if (q->side[1].g == NULL)
+        return len;
+    for (int v = q->side[1].parent[meet]; v >= 0; v = q->side[1].parent[v]) {
+        if (path != NULL)
+            path[len] = v;
+        len++;
+    }
+    return len;
+}
+
+// Dijkstra from s that stops as soon as t is settled. Returns the distance
+// (INT_MAX if t is unreachable) and, if path is not NULL, stores the
+// vertices of a shortest path in it (room for V entries) and their number
+// in *path_len.
+static inline int sssp_point_query(SsspPointQuery* q, int s, int t, int* path, int* path_len) {
+    SsspSide* side = &q->side[0];
+    const Graph* g = side->g;
+    int* dist = side->dist;
+    sssp_side_start(side, s);
+
+    while (!heap_empty(side->heap)) {
+        int u = heap_pop(side->heap).node;
+        side->settled++;
+        if (u == t)
+            break;
+        int du = dist[u];
+        for (long e = g->indexofNodes[u]; e < g->indexofNodes[u + 1]; e++) {
+            int v = g->edgeList[e];
+            int nd = du + g->edgeLen[e];
+            if (nd < dist[v]) {
+                if (dist[v] == INT_MAX)
+                    side->touched[side->num_touched++] = v;
+                dist[v] = nd;
+                side->parent[v] = u;
+                heap_push_or_decrease(side->heap, v, nd);
+            }
+        }
+    }
+
+    int result = dist[t];
+    int len = result == INT_MAX ? 0 : sssp_point_path(q, t, path);
+    if (path_len != NULL)
+        *path_len = len;
+    sssp_side_reset(side);
+    return result;
+}
+
+static inline void sssp_point_offer(SsspPointQuery* q, unsigned long long length, int v) {
+    unsigned long long key = length << 32 | (unsigned)v;
+    unsigned long long old = __atomic_load_n(&q->best, __ATOMIC_SEQ_CST);
+    while (key < old && !__atomic_compare_exchange_n(&q->best, &old, key, true,
+                                                     __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+        ;
+}
+
+// Pops and scans one vertex of side d. Every improved vertex is checked
+// against the other side's distance as a candidate meeting point. The
+// store of the new distance and the load of the other side's are both
+// sequentially consistent: of two sides reaching a vertex at the same time
+// at least one sees the other's distance, so no meeting point is missed.
+// Returns false when the side has nothing left to scan.
+static inline bool sssp_bidir_step(SsspPointQuery* q, int d) {
+    SsspSide* side = &q->side[d];
+    const int* other = q->side[1 - d].dist;
+    if (heap_empty(side->heap))
+        return false;
+    HeapEntry top = heap_pop(side->heap);
+    __atomic_store_n(&side->top, top.dist, __ATOMIC_RELEASE);
+    side->settled++;
+
+    const Graph* g = side->g;
+    int u = top.node;
+    for (long e = g->indexofNodes[u]; e < g->indexofNodes[u + 1]; e++) {
+        int v = g->edgeList[e];
+        int nd = top.dist + g->edgeLen[e];
+        if (nd < side->dist[v]) {
+            if (side->dist[v] == INT_MAX)
+                side->touched[side->num_touched++] = v;
+            __atomic_store_n(&side->dist[v], nd, __ATOMIC_SEQ_CST);
+            side->parent[v] = u;
+            heap_push_or_decrease(side->heap, v, nd);
+            int dv = __atomic_load_n(&other[v], __ATOMIC_SEQ_CST);
+            if (dv != INT_MAX)
+                sssp_point_offer(q, (unsigned long long)nd + dv, v);
+        }
+    }
+    return true;
+}
+
+// Meet-in-the-middle stopping rule: every vertex side d has not settled is
+// at least its heap minimum away, every vertex the other side has not
+// settled at least the key it last popped. Once the two add up to the best
+// path seen, no unseen path can be shorter. The other side's key is read
+// before the best path so any candidate it offered before popping that
+// key is visible.
+static inline bool sssp_bidir_finished(SsspPointQuery* q, int d) {
+    const SsspSide* side = &q->side[d];
+    if (heap_empty(side->heap))
+        return true;
+    long other = __atomic_load_n(&q->side[1 - d].top, __ATOMIC_ACQUIRE);
+    unsigned long long best = __atomic_load_n(&q->best, __ATOMIC_SEQ_CST) >> 32;
+    return (unsigned long long)(side->heap->nodes[0].dist + other) >= best;
+}
+
+// One thread runs both sides, always advancing the one with the smaller
+// frontier. A side that empties its heap ends the search, so when t cannot
+// be reached from s the smaller of the two components decides it.
+static inline void sssp_bidir_alternate(SsspPointQuery* q) {
+    for (;;) {
+        int d = q->side[0].heap->size > q->side[1].heap->size;
+        if (sssp_bidir_finished(q, d) || !sssp_bidir_step(q, d))
+            return;
+    }
+}
+
+// Bidirectional Dijkstra: with two or more OpenMP threads the forward
+// search from s and the backward search from t over the transpose run on
+// one thread each until either side can prove the best meeting point
+// optimal; with one thread the sides alternate. Same contract as
+// sssp_point_query; needs the transpose passed to sssp_point_init.
+static inline int sssp_point_query_bidirectional(SsspPointQuery* q, int s, int t, int* path,
+                                                 int* path_len) {
+    if (q->side[1].g == NULL) {
+        fprintf(stderr, "Error: Bidirectional queries need the transposed graph\n");
+        exit(EXIT_FAILURE);
+    }
+    sssp_side_start(&q->side[0], s);
+    sssp_side_start(&q->side[1], t);
+    q->best = s == t ? (unsigned long long)(unsigned)s : ~0ULL;
+    q->done = 0;
+
+    if (omp_get_max_threads() >= 2) {
+        #pragma omp parallel num_threads(2)
+        {
+            if (omp_get_num_threads() < 2) {
+                sssp_bidir_alternate(q);
+            } else {
+                int d = omp_get_thread_num();
+                while (!__atomic_load_n(&q->done, __ATOMIC_ACQUIRE)) {
+                    if (sssp_bidir_finished(q, d) || !sssp_bidir_step(q, d))
+                        __atomic_store_n(&q->done, 1, __ATOMIC_RELEASE);
+                }
+            }
+        }
+    } else {
+        sssp_bidir_alternate(q);
+    }
+
+    int result = INT_MAX, len = 0;
+    if (q->best != ~0ULL) {
+        result = (int)(q->best >> 32);
+        len = sssp_point_path(q, (int)(q->best & 0xffffffffu), path);
+    }
+    if (path_len != NULL)
+        *path_len = len;
+    sssp_side_reset(&q->side[0]);
+    sssp_side_reset(&q->side[1]);
+    return result;
+}
+
+
+// Single-source front end. sssp_solver_init looks at the weights once and
+// picks the kernel for every later sssp_solve:
+//   SSSP_KERNEL_BFS       all edges have the same weight c; a level-
+//                         synchronous BFS gives dist = c * level
+//   SSSP_KERNEL_DIAL      non-negative weights up to SSSP_DIAL_MAX_WEIGHT;
+//                         Dijkstra over a circular bucket queue
+//   SSSP_KERNEL_RADIX     any other non-negative weights; Dijkstra over a
+//                         radix heap
+//   SSSP_KERNEL_FRONTIER  negative weights; sssp_frontier on the whole team
+// Either way dist gets INT_MAX for unreachable vertices, as everywhere else.
+#define SSSP_KERNEL_FRONTIER 0
+#define SSSP_KERNEL_BFS 1
+#define SSSP_KERNEL_DIAL 2
+#define SSSP_KERNEL_RADIX 3
+#define SSSP_KERNELS 4
+
+// Largest weight for the bucket queue: a pop may scan this many empty
+// buckets, and each thread's share of a small bucket stops paying for the
+// barriers around it well before then.
+#define SSSP_DIAL_MAX_WEIGHT 1024
+
+// Direction switching thresholds (Beamer et al.): go bottom-up once the
+// frontier's out-edges exceed 1/ALPHA of the unexplored edges, back top-down
+// once a shrinking frontier holds fewer than 1/BETA of the vertices.
+#define SSSP_BFS_ALPHA 15
+#define SSSP_BFS_BETA 18
+
+typedef struct {
+    const Graph* g;
+    const Graph* rev;              // in-edges for bottom-up steps, may be NULL
+    int weight;                    // common weight of all edges, -1 if they differ
+    int min_weight;
+    int max_weight;
+    int kernel;                    // may be overridden between init and solve
+    SsspTeam team;
+    DialQueue dial;                // allocated on first use
+    RadixHeap radix;
+    unsigned long long* front;     // bottom-up frontier bitmaps
+    unsigned long long* next_bits;
+    // Statistics of the last BFS.
+    int levels;
+    int bottom_up_levels;
+    long examined;                 // edges looked at, both directions
+    // Statistics of the last bucket-queue run.
+    long buckets;                  // buckets popped
+    long stale;                    // queue entries skipped as outdated
+} SsspSolver;
+
+static inline const char* sssp_kernel_name(int kernel) {
+    static const char* names[SSSP_KERNELS] = { "frontier", "bfs", "dial", "radix" };
+    return names[kernel];
+}
+
+// Whether the kernel gives correct distances on the solver's graph. BFS
+// scales levels by the common weight at the end, so the deepest possible
+// level, n - 1, times the weight must stay below INT_MAX.
+static inline bool sssp_kernel_applies(const SsspSolver* s, int kernel) {
+    switch (kernel) {
+    case SSSP_KERNEL_BFS:
+        return s->weight >= 0 && (long)s->weight * (s->g->num_nodes > 1 ? s->g->num_nodes - 1 : 0) < INT_MAX;
+    case SSSP_KERNEL_DIAL:  return s->min_weight >= 0 && s->max_weight <= SSSP_DIAL_MAX_WEIGHT;
+    case SSSP_KERNEL_RADIX: return s->min_weight >= 0;
+    default:                return true;
+    }
+}
+
+// rev is the transpose of g (g itself when g is undirected) or NULL, in
+// which case the BFS stays top-down.
+static inline void sssp_solver_init(SsspSolver* s, const Graph* g, const Graph* rev) {
+    memset(s, 0, sizeof(*s));
+    s->g = g;
+    s->rev = rev;
+    int n = g->num_nodes;
+    int min_weight = INT_MAX, max_weight = INT_MIN;
+    #pragma omp parallel for schedule(static) reduction(min:min_weight) reduction(max:max_weight)
+    for (long e = 0; e < g->num_edges; e++) {
+        if (g->edgeLen[e] < min_weight)
+            min_weight = g->edgeLen[e];
+        if (g->edgeLen[e] > max_weight)
+            max_weight = g->edgeLen[e];
+    }
+    s->weight = g->num_edges == 0 ? 1 : min_weight == max_weight && min_weight >= 0 ? min_weight : -1;
+    s->min_weight = g->num_edges == 0 ? 1 : min_weight;
+    s->max_weight = g->num_edges == 0 ? 1 : max_weight;
+    if (sssp_kernel_applies(s, SSSP_KERNEL_BFS))
+        s->kernel = SSSP_KERNEL_BFS;
+    else if (sssp_kernel_applies(s, SSSP_KERNEL_DIAL))
+        s->kernel = SSSP_KERNEL_DIAL;
+    else if (sssp_kernel_applies(s, SSSP_KERNEL_RADIX))
+        s->kernel = SSSP_KERNEL_RADIX;
+    else
+        s->kernel = SSSP_KERNEL_FRONTIER;
+
+    long words = (n + 63) / 64;
+    s->team.queued = (unsigned char*)graph_malloc(n, "frontier flags");
+    s->team.frontier = (int*)graph_malloc(n * sizeof(int), "frontier");
+    s->team.next = (int*)graph_malloc(n * sizeof(int), "frontier");
+    s->front = (unsigned long long*)graph_malloc(words * sizeof(unsigned long long), "frontier bitmap");
+    s->next_bits = (unsigned long long*)graph_malloc(words * sizeof(unsigned long long), "frontier bitmap");
+}
+
+static inline void sssp_solver_free(SsspSolver* s) {
+    if (s->dial.buckets)
+        dial_free(&s->dial);
+    radix_free(&s->radix);
+    free(s->team.queued);
+    free(s->team.frontier);
+    free(s->team.next);
+    free(s->front);
+    free(s->next_bits);
+    memset(s, 0, sizeof(*s));
+}
+
+// Appends the chunk in local to the shared list at *size.
+static inline void sssp_flush_chunk(int* list, long* size, const int* local, int k) {
+    long at = __atomic_fetch_add(size, k, __ATOMIC_RELAXED);
+    memcpy(list + at, local, k * sizeof(int));
+}
+
+// Direction-optimizing BFS into dist, levels first and scaled by the common
+// weight at the end. Top-down steps claim a vertex with a compare-and-swap
+// on its dist from INT_MAX, so each vertex enters the next queue exactly
+// once. Bottom-up steps give each thread whole 64-vertex words of the next
+// bitmap: an unvisited vertex scans its in-edges for a parent in the
+// frontier bitmap and stops at the first, with no atomics at all.
+static inline void sssp_bfs(SsspSolver* s, int src, int* dist) {
+    const Graph* g = s->g;
+    const Graph* rev = s->rev;
+    int n = g->num_nodes;
+    long words = (n + 63) / 64;
+    int* queue = s->team.frontier;
+    int* next_queue = s->team.next;
+    unsigned long long* front = s->front;
+    unsigned long long* next_bits = s->next_bits;
+    long size = 1, next_size = 0, filled = 0;
+    long next_edges = 0;
+    long unexplored = g->num_edges - out_degree(g, src);
+    int level = 0;
+    bool bottom_up = false, switch_direction = false;
+    long examined = 0;
+    s->bottom_up_levels = 0;
+
+    #pragma omp parallel reduction(+:examined)
+    {
+        #pragma omp for schedule(static)
+        for (int v = 0; v < n; v++)
+            dist[v] = INT_MAX;
+        #pragma omp single
+        {
+            dist[src] = 0;
+            queue[0] = src;
+        }
+
+        while (size > 0) {
+            long edges = 0;
+            if (!bottom_up) {
+                int local[SSSP_FRONTIER_CHUNK];
+                int k = 0;
+                #pragma omp for schedule(dynamic, 64) nowait
+                for (long i = 0; i < size; i++) {
+                    int u = queue[i];
+                    examined += out_degree(g, u);
+                    for (long e = g->indexofNodes[u]; e < g->indexofNodes[u + 1]; e++) {
+                        int v = g->edgeList[e];
+                        int unseen = INT_MAX;
+                        if (__atomic_load_n(&dist[v], __ATOMIC_RELAXED) == INT_MAX &&
+                            __atomic_compare_exchange_n(&dist[v], &unseen, level + 1, false,
+                                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                            if (k == SSSP_FRONTIER_CHUNK) {
+                                sssp_flush_chunk(next_queue, &next_size, local, k);
+                                k = 0;
+                            }
+                            local[k++] = v;
+                            edges += out_degree(g, v);
+                        }
+                    }
+                }
+                if (k > 0)
+                    sssp_flush_chunk(next_queue, &next_size, local, k);
+            } else {
+                long found = 0;
+                #pragma omp for schedule(dynamic, 16) nowait
+                for (long w = 0; w < words; w++) {
+                    unsigned long long bits = 0;
+                    int end = n - w * 64 < 64 ? (int)(n - w * 64) : 64;
+                    for (int j = 0; j < end; j++) {
+                        int v = (int)(w * 64 + j);
+                        if (dist[v] != INT_MAX)
+                            continue;
+                        for (long e = rev->indexofNodes[v]; e < rev->indexofNodes[v + 1]; e++) {
+                            int u = rev->edgeList[e];
+                            examined++;
+                            if (front[u >> 6] >> (u & 63) & 1) {
+                                dist[v] = level + 1;
+                                bits |= 1ULL << j;
+                                found++;
+                                edges += out_degree(g, v);
+                                break;
+                            }
+                        }
+                    }
+                    next_bits[w] = bits;
+                }
+                __atomic_fetch_add(&next_size, found, __ATOMIC_RELAXED);
+            }
+            __atomic_fetch_add(&next_edges, edges, __ATOMIC_RELAXED);
+            #pragma omp barrier
+            #pragma omp single
+            {
+                unexplored -= next_edges;
+                bool want = rev != NULL &&
+                            (bottom_up ? !(next_size < n / SSSP_BFS_BETA && next_size < size)
+                                       : next_edges > unexplored / SSSP_BFS_ALPHA);
+                switch_direction = want != bottom_up;
+                if (bottom_up)
+                    s->bottom_up_levels++;
+                if (!switch_direction) {
+                    if (bottom_up) {
+                        unsigned long long* swap = front;
+                        front = next_bits;
+                        next_bits = swap;
+                    } else {
+                        int* swap = queue;
+                        queue = next_queue;
+                        next_queue = swap;
+                    }
+                }
+                level++;
+                size = next_size;
+                next_size = 0;
+                next_edges = 0;
+                filled = 0;
+            }
+
+            if (switch_direction && !bottom_up) {
+                // The new frontier is in next_queue; set its bits in front.
+                #pragma omp for schedule(static)
+                for (long w = 0; w < words; w++)
+                    front[w] = 0;
+                #pragma omp for schedule(static)
+                for (long i = 0; i < size; i++)
+                    testAndSetBit(front, next_queue[i]);
+            } else if (switch_direction) {
+                // The new frontier is in next_bits; list it in queue.
+                int local[SSSP_FRONTIER_CHUNK];
+                int k = 0;
+                #pragma omp for schedule(static) nowait
+                for (long w = 0; w < words; w++) {
+                    for (unsigned long long bits = next_bits[w]; bits; bits &= bits - 1) {
+                        if (k == SSSP_FRONTIER_CHUNK) {
+                            sssp_flush_chunk(queue, &filled, local, k);
+                            k = 0;
+                        }
+                        local[k++] = (int)(w * 64 + __builtin_ctzll(bits));
+                    }
+                }
+                if (k > 0)
+                    sssp_flush_chunk(queue, &filled, local, k);
+                #pragma omp barrier
+            }
+            #pragma omp single
+            if (switch_direction)
+                bottom_up = !bottom_up;
+        }
+
+        if (s->weight != 1) {
+            #pragma omp for schedule(static)
+            for (int v = 0; v < n; v++)
+                if (dist[v] != INT_MAX)
+                    dist[v] *= s->weight;
+        }
+    }
+    s->team.frontier = queue;
+    s->team.next = next_queue;
+    s->front = front;
+    s->next_bits = next_bits;
+    s->levels = level;
+    s->examined = examined;
+}
+
+// Dijkstra over a monotone bucket queue, the Dial queue or the radix heap
+// as s->kernel says. All vertices of the lowest bucket have their final
+// distance, so the team relaxes them in parallel with atomicMin; the
+// improved vertices are collected once each through the queued flags and
+// pushed by one thread at their final distance for the round. Zero-weight
+// edges push into the bucket being processed, which is simply popped again.
+static inline void sssp_buckets(SsspSolver* s, int src, int* dist) {
+    const Graph* g = s->g;
+    int n = g->num_nodes;
+    bool dial = s->kernel == SSSP_KERNEL_DIAL;
+    if (dial && s->dial.buckets == NULL)
+        dial_init(&s->dial, s->max_weight);
+    if (dial)
+        dial_clear(&s->dial);
+    else
+        radix_clear(&s->radix);
+    int* bucket = s->team.frontier;
+    int* improved = s->team.next;
+    long bucket_size = 0, improved_size = 0, key = 0, buckets = 0, stale = 0;
+
+    #pragma omp parallel
+    {
+        #pragma omp for schedule(static)
+        for (int v = 0; v < n; v++) {
+            dist[v] = INT_MAX;
+            s->team.queued[v] = 0;
+        }
+        #pragma omp single
+        {
+            dist[src] = 0;
+            if (dial)
+                dial_push(&s->dial, src, 0);
+            else
+                radix_push(&s->radix, src, 0);
+        }
+
+        for (;;) {
+            #pragma omp single
+            {
+                bucket_size = dial ? dial_pop_bucket(&s->dial, bucket, &key)
+                                   : radix_pop_bucket(&s->radix, bucket, &key);
+                buckets += bucket_size > 0;
+            }
+            if (bucket_size == 0)
+                break;
+
+            int local[SSSP_FRONTIER_CHUNK];
+            int k = 0;
+            #pragma omp for schedule(dynamic, 64) reduction(+:stale)
+            for (long i = 0; i < bucket_size; i++) {
+                int u = bucket[i];
+                if (dist[u] != key) {
+                    stale++;
+                    continue;
+                }
+                for (long e = g->indexofNodes[u]; e < g->indexofNodes[u + 1]; e++) {
+                    int v = g->edgeList[e];
+                    int nd = (int)key + g->edgeLen[e];
+                    if (nd < dist[v] && atomicMin(&dist[v], nd) && testAndSetFlag(&s->team.queued[v])) {
+                        local[k++] = v;
+                        if (k == SSSP_FRONTIER_CHUNK) {
+                            sssp_flush_chunk(improved, &improved_size, local, k);
+                            k = 0;
+                        }
+                    }
+                }
+            }
+            if (k)
+                sssp_flush_chunk(improved, &improved_size, local, k);
+            #pragma omp barrier
+
+            #pragma omp single
+            {
+                for (long i = 0; i < improved_size; i++) {
+                    int v = improved[i];
+                    s->team.queued[v] = 0;
+                    if (dial)
+                        dial_push(&s->dial, v, dist[v]);
+                    else
+                        radix_push(&s->radix, v, (unsigned)dist[v]);
+                }
+                improved_size = 0;
+            }
+        }
+    }
+    s->buckets = buckets;
+    s->stale = stale;
+}
+
+// Distances from src into dist with the kernel picked at init, on the
+// current number of OpenMP threads. Returns the kernel used.
+static inline int sssp_solve(SsspSolver* s, int src, int* dist) {
+    if (s->kernel == SSSP_KERNEL_BFS) {
+        sssp_bfs(s, src, dist);
+    } else if (s->kernel == SSSP_KERNEL_DIAL || s->kernel == SSSP_KERNEL_RADIX) {
+        sssp_buckets(s, src, dist);
+    } else {
+        s->team.dist = dist;
+        #pragma omp parallel
+        sssp_frontier(s->g, src, &s->team);
+        s->team.dist = NULL;
+    }
+    return s->kernel;
+}
+
+// Relaxed priority-queue SSSP. Every thread pops a (distance, vertex) key
+// from a MultiQueue of SSSP_MQ_HEAPS_PER_THREAD heaps per thread, skips it
+// if the vertex has since been reached more cheaply (a stale key), and
+// otherwise relaxes its out-edges with atomicMin, pushing every improved
+// vertex. Because pops are only nearly in order, a vertex can be scanned
+// at a distance that later drops and be scanned again; SsspMqStats counts
+// that wasted work. pending counts keys pushed but not yet fully handled,
+// so the search is over when it reaches zero.
+#define SSSP_MQ_HEAPS_PER_THREAD 2
+
+typedef struct {
+    long pops;          // keys taken off the queue
+    long stale;         // of those, skipped because the vertex had improved
+    long scans;         // vertices whose edges were relaxed
+    long reached;       // vertices with a finite distance
+    long relaxations;   // edges relaxed over all scans
+    long needed;        // out-edges of the reached vertices, what Dijkstra relaxes
+} SsspMqStats;
+
+static inline unsigned long long sssp_mq_key(int dist, int v) {
+    return ((unsigned long long)(unsigned)dist << 32) | (unsigned)v;
+}
+
+// Keys a thread has pushed and keys it has popped and finished with, each
+// only ever raised by its owner, one cache line per thread so the counts
+// of a push or pop are never contended.
+typedef struct {
+    long pushed;
+    long done;
+} __attribute__((aligned(64))) SsspMqCount;
+
+// True once no key is in flight. A key is counted as pushed before it is
+// visible in the queue and as done after the keys it produced are pushed,
+// so at any moment done <= pushed in total. Reading every done count
+// before any pushed count bounds the first sum from above and the second
+// from below by their values at one instant between the two passes;
+// equal sums mean the queue was empty then, and it stays so.
+static inline bool sssp_mq_idle(const SsspMqCount* count, int threads) {
+    long done = 0, pushed = 0;
+    for (int t = 0; t < threads; t++)
+        done += __atomic_load_n(&count[t].done, __ATOMIC_ACQUIRE);
+    for (int t = 0; t < threads; t++)
+        pushed += __atomic_load_n(&count[t].pushed, __ATOMIC_ACQUIRE);
+    return done == pushed;
+}
+
+// Distances from src into dist on the current number of OpenMP threads;
+// stats may be NULL.
+static inline void sssp_multiqueue(const Graph* g, int src, int* dist, SsspMqStats* stats) {
+    int n = g->num_nodes;
+    int threads = omp_get_max_threads();
+    MultiQueue q;
+    mq_init(&q, SSSP_MQ_HEAPS_PER_THREAD * threads, n / (SSSP_MQ_HEAPS_PER_THREAD * threads) + 1);
+
+    #pragma omp parallel for schedule(static)
+    for (int v = 0; v < n; v++)
+        dist[v] = INT_MAX;
+    dist[src] = 0;
+    unsigned long long seed = 0x9e3779b97f4a7c15ULL;
+    SsspMqCount* count = (SsspMqCount*)aligned_alloc(64, threads * sizeof(SsspMqCount));
+    memset(count, 0, threads * sizeof(SsspMqCount));
+    count[0].pushed = 1;
+    mq_push(&q, &seed, sssp_mq_key(0, src));
+
+    long pops = 0, stale = 0, scans = 0, relaxations = 0;
+    #pragma omp parallel reduction(+:pops, stale, scans, relaxations)
+    {
+        unsigned long long rng = 0x9e3779b97f4a7c15ULL * (omp_get_thread_num() + 1);
+        SsspMqCount* mine = &count[omp_get_thread_num()];
+        for (;;) {
+            unsigned long long key;
+            if (!mq_pop(&q, &rng, &key)) {
+                if (sssp_mq_idle(count, threads))
+                    break;
+                continue;
+            }
+            pops++;
+            int u = (int)(unsigned)key;
+            int du = (int)(key >> 32);
+            if (du > __atomic_load_n(&dist[u], __ATOMIC_RELAXED)) {
+                stale++;
+                __atomic_store_n(&mine->done, mine->done + 1, __ATOMIC_RELEASE);
+                continue;
+            }
+            scans++;
+            relaxations += out_degree(g, u);
+            for (long i = g->indexofNodes[u]; i < g->indexofNodes[u + 1]; i++) {
+                int v = g->edgeList[i];
+                int nd = du + g->edgeLen[i];
+                if (nd < dist[v] && atomicMin(&dist[v], nd)) {
+                    __atomic_store_n(&mine->pushed, mine->pushed + 1, __ATOMIC_RELEASE);
+                    mq_push(&q, &rng, sssp_mq_key(nd, v));
+                }
+            }
+            __atomic_store_n(&mine->done, mine->done + 1, __ATOMIC_RELEASE);
+        }
+    }
+    mq_free(&q);
+    free(count);
+
+    if (stats) {
+        long reached = 0, needed = 0;
+        #pragma omp parallel for schedule(static) reduction(+:reached, needed)
+        for (int v = 0; v < n; v++)
+            if (dist[v] != INT_MAX) {
+                reached++;
+                needed += out_degree(g, v);
+            }
+        stats->pops = pops;
+        stats->stale = stale;
+        stats->scans = scans;
+        stats->reached = reached;
+        stats->relaxations = relaxations;
+        stats->needed = needed;
+    }
+}
+
+#endif